@@ -0,0 +1,173 @@
+// High-resolution clock.
+//
+// Time is read from the TSC, calibrated against the PIT at boot.
+// Each CPU runs its LAPIC timer in one-shot mode and arms it for
+// the earlier of the next clock tick and the first high-resolution
+// sleeper on that CPU, so nanosleep() doesn't wait for a tick.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "memlayout.h"
+#include "mmu.h"
+#include "proc.h"
+#include "x86.h"
+#include "spinlock.h"
+
+uint tsc_khz;           // TSC cycles per millisecond, 0 if not calibrated
+static uint64 tsc0;     // TSC at boot
+
+struct hrsleeper {
+  uint64 deadline;             // TSC value to wake up at
+  int done;                    // Has the deadline passed?
+  struct hrsleeper *next;      // Next sleeper by deadline
+};
+
+// Per-CPU queue of high-resolution sleepers.
+struct hrq {
+  struct spinlock lock;
+  uint64 nexttick;             // TSC value of the next clock tick
+  struct hrsleeper *head;      // Sleepers sorted by deadline
+} hrqs[NCPU];
+
+void
+clockinit(void)
+{
+  uint64 t0;
+  int i;
+
+  for(i = 0; i < NCPU; i++)
+    initlock(&hrqs[i].lock, "hrq");
+
+  t0 = rdtsc();
+  pitdelay(10);
+  tsc0 = rdtsc();
+  tsc_khz = (uint)(tsc0 - t0) / 10;
+}
+
+// Nanoseconds since boot.
+uint64
+nanotime(void)
+{
+  if(tsc_khz == 0)
+    return (uint64)ticks * TICKMS * 1000000;
+  return tsc2ns(rdtsc());
+}
+
+// Nanoseconds since boot at TSC value tsc.
+uint64
+tsc2ns(uint64 tsc)
+{
+  uint64 ms;
+  uint r;
+
+  if(tsc_khz == 0)
+    return 0;
+  ms = divu64(tsc - tsc0, tsc_khz, &r);
+  return ms * 1000000 + divu64((uint64)r * 1000000, tsc_khz, 0);
+}
+
+static uint64
+ns2tsc(uint64 ns)
+{
+  uint64 ms;
+  uint r;
+
+  ms = divu64(ns, 1000000, &r);
+  return ms * tsc_khz + divu64((uint64)r * tsc_khz, 1000000, 0);
+}
+
+// Arm the LAPIC timer of this CPU for the next tick or sleeper,
+// whichever comes first. q->lock must be held.
+static void
+hrq_arm(struct hrq *q, uint64 now)
+{
+  uint64 next;
+
+  next = q->nexttick;
+  if(q->head && q->head->deadline < next)
+    next = q->head->deadline;
+  if(next <= now)
+    lapictimer(1);
+  else
+    lapictimer(divu64((next - now) * lapic_khz, tsc_khz, 0) + 1);
+}
+
+// Handle a timer interrupt on this CPU: wake up sleepers whose
+// deadline has passed and re-arm the timer.
+// Returns 1 if the interrupt is a clock tick.
+int
+clockintr(void)
+{
+  struct hrq *q;
+  struct hrsleeper *s;
+  uint64 now, slack;
+  int tick;
+
+  if(tsc_khz == 0)
+    return 1;
+
+  q = &hrqs[cpunum()];
+  acquire(&q->lock);
+  now = rdtsc();
+  slack = tsc_khz / 64;  // don't re-arm for a tick just ahead
+
+  tick = 0;
+  if(lapic_khz == 0 || now + slack >= q->nexttick){
+    tick = 1;
+    q->nexttick += (uint64)tsc_khz * TICKMS;
+    if(q->nexttick <= now)
+      q->nexttick = now + (uint64)tsc_khz * TICKMS;
+  }
+
+  while((s = q->head) != 0 && s->deadline <= now){
+    q->head = s->next;
+    s->done = 1;
+    wakeup(s);
+  }
+
+  hrq_arm(q, now);
+  release(&q->lock);
+  return tick;
+}
+
+// Sleep for ns nanoseconds.
+// Returns -1 if killed or the clock isn't calibrated.
+int
+nanosleep(uint64 ns)
+{
+  struct hrsleeper s, **pp;
+  struct hrq *q;
+  uint64 now;
+
+  if(tsc_khz == 0)
+    return -1;
+
+  pushcli();
+  q = &hrqs[cpunum()];
+  acquire(&q->lock);
+  popcli();
+
+  now = rdtsc();
+  s.deadline = now + ns2tsc(ns);
+  s.done = 0;
+  for(pp = &q->head; *pp && (*pp)->deadline <= s.deadline; pp = &(*pp)->next)
+    ;
+  s.next = *pp;
+  *pp = &s;
+  if(q->head == &s)
+    hrq_arm(q, now);
+
+  while(!s.done){
+    if(proc->killed){
+      for(pp = &q->head; *pp != &s; pp = &(*pp)->next)
+        ;
+      *pp = s.next;
+      release(&q->lock);
+      return -1;
+    }
+    sleep(&s, &q->lock);
+  }
+  release(&q->lock);
+  return 0;
+}
@@ -2,9 +2,13 @@ struct buf;
 struct context;
 struct file;
 struct inode;
+struct ktimer;
 struct pipe;
 struct proc;
 struct rtcdate;
+struct schedconf;
+struct schedstat;
+struct traceev;
 struct spinlock;
 struct sleeplock;
 struct stat;
@@ -16,6 +20,14 @@ struct buf*     bread(uint, uint);
 void            brelse(struct buf*);
 void            bwrite(struct buf*);
 
+// clock.c
+void            clockinit(void);
+int             clockintr(void);
+uint64          nanotime(void);
+uint64          tsc2ns(uint64);
+int             nanosleep(uint64);
+extern uint     tsc_khz;
+
 // console.c
 void            consoleinit(void);
 void            cprintf(char*, ...);
@@ -53,6 +65,11 @@ int             readi(struct inode*, char*, uint, uint);
 void            stati(struct inode*, struct stat*);
 int             writei(struct inode*, char*, uint, uint);
 
+// futex.c
+void            futexinit(void);
+int             futex_wait(uint, uint);
+int             futex_wake(uint, int);
+
 // ide.c
 void            ideinit(void);
 void            ideintr(void);
@@ -72,12 +89,21 @@ void            kinit2(void*, void*);
 // kbd.c
 void            kbdintr(void);
 
+// ktimer.c
+void            ktimer_init(struct ktimer*, void (*)(void*), void*);
+void            ktimer_arm(struct ktimer*, uint);
+int             ktimer_cancel(struct ktimer*);
+void            ktimer_tick(uint);
+
 // lapic.c
 void            cmostime(struct rtcdate *r);
 int             cpunum(void);
 extern volatile uint*    lapic;
 void            lapiceoi(void);
 void            lapicinit(void);
+void            lapicipi(uchar, int);
+void            lapictimer(uint);
+extern uint     lapic_khz;
 void            lapicstartap(uchar, uint);
 void            microdelay(int);
 
@@ -115,11 +141,23 @@ void            sleep(void*, struct spinlock*);
 void            userinit(void);
 int             wait(void);
 void            wakeup(void*);
+int             wakeupn(void*, int);
 void            yield(int timer_interrupt);            
 int             getlev(void);
 int             set_cpu_share(int share);
+int             getschedstat(struct schedstat*);
+int             getschedconf(struct schedconf*);
+int             setschedconf(struct schedconf*);
+int             sched_setaffinity(int, uint);
+int             sched_getaffinity(int);
+int             set_gang(int);
+int             yield_to(int);
+int             sched_deadline(int, int, int);
+void            edf_yield(void);
+void            edf_tick(void);
 void            add_clock(void);
-int             thread_create(thread_t *thread, void *(*start_routine)(void *), void *arg);
+void            load_balance(void);
+int             thread_create(thread_t *thread, void *(*start_routine)(void *), void *arg, int stacksize);
 void            thread_exit(void *retval);
 int             thread_join(thread_t thread, void **retval);
 
@@ -159,8 +197,14 @@ int             fetchstr(uint, char**);
 void            syscall(void);
 
 // timer.c
+void            pitdelay(int);
 void            timerinit(void);
 
+// trace.c
+void            traceinit(void);
+void            trace(int, struct proc*, int);
+int             tracedrain(struct traceev*, int);
+
 // trap.c
 void            idtinit(void);
 extern uint     ticks;
@@ -184,9 +228,11 @@ void            inituvm(pde_t*, char*, uint);
 int             loaduvm(pde_t*, char*, struct inode*, uint, uint);
 pde_t*          copyuvm(pde_t*, uint);
 void            switchuvm(struct proc*);
+void            switchtss(struct proc*);
 void            switchkvm(void);
 int             copyout(pde_t*, uint, void*, uint);
 void            clearpteu(pde_t *pgdir, char *uva);
+int             uvmmapped(pde_t*, uint);
 int             my_syscall(char*);
 
 // number of elements in fixed-size array
@@ -96,6 +96,7 @@ exec(char *path, char **argv)
   proc->pgdir = pgdir;
   proc->sz = sz;
   proc->std = sz;
+  proc->ntscache = 0;  // cached thread stacks were in the old image
   proc->tf->eip = elf.entry;  // main
   proc->tf->esp = sp;
   switchuvm(proc);
@@ -0,0 +1,100 @@
+// Futexes.
+//
+// futex_wait() sleeps only if the user word at addr still holds
+// val, and futex_wake() wakes threads sleeping on that word. Both
+// key on the kernel address of the physical word, so every thread
+// which shares the page table finds the same waiters.
+//
+// The check in futex_wait() and the wakeup in futex_wake() run
+// under the futex lock which the word hashes to. A thread which
+// changes the word and then calls futex_wake() either finds the
+// waiter asleep, or the waiter sees the new value and returns.
+// Waiters sleep on the hashed sleep queues (see sleep()), so a
+// wakeup only looks at threads which may wait on the same word.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "memlayout.h"
+#include "mmu.h"
+#include "proc.h"
+#include "spinlock.h"
+
+#define NFUTEXLOCK 31
+
+struct spinlock futexlocks[NFUTEXLOCK];
+
+void
+futexinit(void)
+{
+  int i;
+
+  for(i = 0; i < NFUTEXLOCK; i++)
+    initlock(&futexlocks[i], "futex");
+}
+
+// Kernel address of the user word at addr, or 0 if it isn't
+// a mapped, aligned user word.
+static uint*
+futex_key(uint addr)
+{
+  struct proc *g;
+  char *ka;
+
+  g = proc->tid > 0 ? proc->parent : proc;
+  if(addr % sizeof(uint) != 0 || addr >= g->sz || addr + sizeof(uint) > g->sz)
+    return 0;
+  if((ka = uva2ka(proc->pgdir, (char*)PGROUNDDOWN(addr))) == 0)
+    return 0;
+  return (uint*)(ka + (addr & (PGSIZE - 1)));
+}
+
+static struct spinlock*
+futex_lock(uint *key)
+{
+  return &futexlocks[((uint)key >> 2) % NFUTEXLOCK];
+}
+
+// Sleep until woken by futex_wake() if the word at addr holds val.
+// Returns 0 when woken, -1 if the word holds another value,
+// addr is bad or the caller was killed.
+int
+futex_wait(uint addr, uint val)
+{
+  struct spinlock *lk;
+  uint *key;
+
+  if((key = futex_key(addr)) == 0)
+    return -1;
+  lk = futex_lock(key);
+
+  acquire(lk);
+  if(*key != val || proc->killed){
+    release(lk);
+    return -1;
+  }
+  sleep(key, lk);
+  release(lk);
+  return 0;
+}
+
+// Wake at most n threads waiting on the word at addr.
+// Returns how many were woken, or -1 if addr is bad.
+int
+futex_wake(uint addr, int n)
+{
+  struct spinlock *lk;
+  uint *key;
+  int woken;
+
+  if((key = futex_key(addr)) == 0)
+    return -1;
+  if(n <= 0)
+    return 0;
+  lk = futex_lock(key);
+
+  acquire(lk);
+  woken = wakeupn(key, n);
+  release(lk);
+  return woken;
+}
@@ -0,0 +1,99 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "param.h"
+#include "date.h"
+#include "schedstat.h"
+
+// Threads meet at a spinning barrier every round while CPU hogs
+// compete for every CPU. Compares the time with and without gang
+// scheduling, where all threads run together or not at all.
+
+#define NROUND  200
+#define NWORK   100000
+
+struct schedstat ss;
+
+int nthread;
+volatile int count;
+volatile int sense;
+
+void
+barrier(int *local)
+{
+  *local = !*local;
+  if(__sync_fetch_and_add(&count, 1) == nthread - 1){
+    count = 0;
+    sense = *local;
+  } else {
+    while(sense != *local)
+      ;
+  }
+}
+
+void*
+worker(void *arg)
+{
+  int i, r, local = 0;
+
+  for(r = 0; r < NROUND; r++){
+    for(i = 0; i < NWORK; i++)
+      __sync_synchronize();
+    barrier(&local);
+  }
+  thread_exit(0);
+}
+
+// Milliseconds to run all rounds.
+int
+run(int gang)
+{
+  thread_t threads[NCPU];
+  struct timespec t0, t1;
+  void *retval;
+  int i;
+
+  set_gang(gang);
+  count = 0;
+  sense = 0;
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  for(i = 0; i < nthread; i++){
+    if(thread_create(&threads[i], worker, 0) != 0){
+      printf(1, "panic at thread_create\n");
+      exit();
+    }
+  }
+  for(i = 0; i < nthread; i++)
+    thread_join(threads[i], &retval);
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  return timespec_diff(&t0, &t1, 1000000);
+}
+
+int
+main(int argc, char *argv[])
+{
+  int hogs[NCPU];
+  int i, off, on;
+
+  getschedstat(&ss);
+  nthread = ss.ncpu < 2 ? 2 : ss.ncpu;
+
+  for(i = 0; i < ss.ncpu; i++){
+    if((hogs[i] = fork()) == 0){
+      for(;;)
+        ;
+    }
+  }
+
+  off = run(0);
+  on = run(1);
+
+  for(i = 0; i < ss.ncpu; i++){
+    kill(hogs[i]);
+    wait();
+  }
+
+  printf(1, "%d threads, %d hogs: without gang %d ms, with gang %d ms\n",
+         nthread, ss.ncpu, off, on);
+  exit();
+}
@@ -0,0 +1,151 @@
+// Kernel timers.
+//
+// Timers are kept on a hierarchical timer wheel keyed by their
+// expiry tick, so a clock tick only looks at timers which expire
+// on that tick. Level 0 has a slot for each of the next WHEELSIZE
+// ticks; a slot of level L covers WHEELSIZE^L ticks. Whenever the
+// lower level wraps around, timers in the next slot of the level
+// above are cascaded down.
+//
+// The wheel is protected by tickslock. Callbacks run from the
+// timer interrupt with tickslock held, so they must not sleep, and
+// a timer which ktimer_cancel() has taken off the wheel never fires.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "spinlock.h"
+#include "ktimer.h"
+
+#define WHEELBITS  6
+#define WHEELSIZE  (1 << WHEELBITS)
+#define WHEELMASK  (WHEELSIZE - 1)
+#define NLEVEL     4
+#define MAXDELTA   ((1 << (WHEELBITS * NLEVEL)) - 1)
+
+struct {
+  uint clk;                                 // Next tick to process
+  struct ktimer *slot[NLEVEL][WHEELSIZE];
+} wheel;
+
+static void
+wheel_insert(struct ktimer *t)
+{
+  struct ktimer **head;
+  uint delta;
+  int lev;
+
+  if((int)(t->expire - wheel.clk) < 0)
+    t->expire = wheel.clk;
+  delta = t->expire - wheel.clk;
+  if(delta > MAXDELTA){
+    delta = MAXDELTA;
+    t->expire = wheel.clk + delta;
+  }
+
+  for(lev = 0; lev < NLEVEL - 1; lev++)
+    if(delta < (1 << (WHEELBITS * (lev + 1))))
+      break;
+  head = &wheel.slot[lev][(t->expire >> (WHEELBITS * lev)) & WHEELMASK];
+
+  t->next = *head;
+  if(t->next)
+    t->next->pprev = &t->next;
+  t->pprev = head;
+  *head = t;
+}
+
+static void
+wheel_remove(struct ktimer *t)
+{
+  *t->pprev = t->next;
+  if(t->next)
+    t->next->pprev = t->pprev;
+  t->next = 0;
+  t->pprev = 0;
+}
+
+// Move timers of slot idx in level lev down to the lower levels.
+// Returns idx so the caller knows whether this level wrapped too.
+static int
+wheel_cascade(int lev, int idx)
+{
+  struct ktimer *t, *next;
+
+  t = wheel.slot[lev][idx];
+  wheel.slot[lev][idx] = 0;
+  for(; t; t = next){
+    next = t->next;
+    wheel_insert(t);
+  }
+  return idx;
+}
+
+void
+ktimer_init(struct ktimer *t, void (*fn)(void*), void *arg)
+{
+  t->fn = fn;
+  t->arg = arg;
+  t->next = 0;
+  t->pprev = 0;
+}
+
+// Arm t to fire at tick expire, re-arming it if already pending.
+// May be called with tickslock held (e.g. from a callback).
+void
+ktimer_arm(struct ktimer *t, uint expire)
+{
+  int locked;
+
+  if(!(locked = holding(&tickslock)))
+    acquire(&tickslock);
+  if(t->pprev)
+    wheel_remove(t);
+  t->expire = expire;
+  wheel_insert(t);
+  if(!locked)
+    release(&tickslock);
+}
+
+// Take t off the wheel. Returns 1 if it was pending, 0 otherwise.
+int
+ktimer_cancel(struct ktimer *t)
+{
+  int locked, pending;
+
+  if(!(locked = holding(&tickslock)))
+    acquire(&tickslock);
+  if((pending = (t->pprev != 0)))
+    wheel_remove(t);
+  if(!locked)
+    release(&tickslock);
+  return pending;
+}
+
+// Fire timers which expire up to tick now.
+// Called by the timer interrupt with tickslock held.
+void
+ktimer_tick(uint now)
+{
+  struct ktimer *t, *expired;
+  int idx, lev;
+
+  while((int)(now - wheel.clk) >= 0){
+    idx = wheel.clk & WHEELMASK;
+    for(lev = 1; idx == 0 && lev < NLEVEL; lev++)
+      idx = wheel_cascade(lev, (wheel.clk >> (WHEELBITS * lev)) & WHEELMASK);
+
+    // Detach the slot first: a callback may re-arm its timer
+    // into the very slot being emptied.
+    idx = wheel.clk & WHEELMASK;
+    wheel.clk++;
+    if((expired = wheel.slot[0][idx]) == 0)
+      continue;
+    wheel.slot[0][idx] = 0;
+    expired->pprev = &expired;
+    while((t = expired) != 0){
+      wheel_remove(t);
+      t->fn(t->arg);
+    }
+  }
+}
@@ -0,0 +1,8 @@
+// Kernel timer, armed with ktimer_arm() to run fn(arg) at a given tick.
+struct ktimer {
+  uint expire;                 // Tick to fire at
+  void (*fn)(void*);           // Callback, run with tickslock held
+  void *arg;                   // Argument of fn
+  struct ktimer *next;         // Next timer in the same wheel slot
+  struct ktimer **pprev;       // Link pointing at this timer, 0 if not armed
+};
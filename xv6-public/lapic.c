@@ -32,6 +32,7 @@
 #define ICRHI   (0x0310/4)   // Interrupt Command [63:32]
 #define TIMER   (0x0320/4)   // Local Vector Table 0 (TIMER)
   #define X1         0x0000000B   // divide counts by 1
+  #define ONESHOT    0x00000000   // One-shot
   #define PERIODIC   0x00020000   // Periodic
 #define PCINT   (0x0340/4)   // Performance Counter LVT
 #define LINT0   (0x0350/4)   // Local Vector Table 1 (LINT0)
@@ -43,6 +44,7 @@
 #define TDCR    (0x03E0/4)   // Timer Divide Configuration
 
 volatile uint *lapic;  // Initialized in mp.c
+uint lapic_khz;        // Timer counts per millisecond, 0 if not calibrated
 
 static void
 lapicw(int index, int value)
@@ -61,13 +63,26 @@ lapicinit(void)
   // Enable local APIC; set spurious interrupt vector.
   lapicw(SVR, ENABLE | (T_IRQ0 + IRQ_SPURIOUS));
 
-  // The timer repeatedly counts down at bus frequency
-  // from lapic[TICR] and then issues an interrupt.
-  // If xv6 cared more about precise timekeeping,
-  // TICR would be calibrated using an external time source.
+  // The timer counts down at bus frequency from lapic[TICR]
+  // and then issues an interrupt. Calibrate it against the PIT
+  // once, on the boot CPU; it is then run in one-shot mode and
+  // clockintr() arms it for the next tick or high-resolution timer.
+  // If it can't be calibrated, it repeatedly counts down from a
+  // guessed TICR instead.
   lapicw(TDCR, X1);
-  lapicw(TIMER, PERIODIC | (T_IRQ0 + IRQ_TIMER));
-  lapicw(TICR, 10000000);
+  if(lapic_khz == 0){
+    lapicw(TIMER, MASKED | (T_IRQ0 + IRQ_TIMER));
+    lapicw(TICR, 0xFFFFFFFF);
+    pitdelay(10);
+    lapic_khz = (0xFFFFFFFF - lapic[TCCR]) / 10;
+  }
+  if(lapic_khz){
+    lapicw(TIMER, ONESHOT | (T_IRQ0 + IRQ_TIMER));
+    lapicw(TICR, lapic_khz * TICKMS);
+  } else {
+    lapicw(TIMER, PERIODIC | (T_IRQ0 + IRQ_TIMER));
+    lapicw(TICR, 10000000);
+  }
 
   // Disable logical interrupt lines.
   lapicw(LINT0, MASKED);
@@ -134,6 +149,27 @@ lapiceoi(void)
     lapicw(EOI, 0);
 }
 
+// Fire the one-shot timer after count timer counts.
+void
+lapictimer(uint count)
+{
+  if(lapic && lapic_khz)
+    lapicw(TICR, count ? count : 1);
+}
+
+// Send an interrupt with the given vector to another CPU.
+void
+lapicipi(uchar apicid, int vector)
+{
+  if(!lapic)
+    return;
+
+  lapicw(ICRHI, apicid<<24);
+  lapicw(ICRLO, FIXED | ASSERT | vector);
+  while(lapic[ICRLO] & DELIVS)
+    ;
+}
+
 // Spin for a given number of microseconds.
 // On real hardware would want to tune this dynamically.
 void
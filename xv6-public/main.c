@@ -21,6 +21,7 @@ main(void)
   kvmalloc();      // kernel page table
   mpinit();        // detect other processors
   lapicinit();     // interrupt controller
+  clockinit();     // high-resolution clock
   seginit();       // segment descriptors
   cprintf("\ncpu%d: starting xv6\n\n", cpunum());
   picinit();       // another interrupt controller
@@ -28,6 +29,8 @@ main(void)
   consoleinit();   // console hardware
   uartinit();      // serial port
   pinit();         // process table
+  traceinit();     // scheduler trace
+  futexinit();     // futex locks
   tvinit();        // trap vectors
   binit();         // buffer cache
   fileinit();      // file table
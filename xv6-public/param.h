@@ -1,4 +1,4 @@
-#define NPROC        64  // maximum number of processes
+#define NPROC       256  // maximum number of processes and threads
 #define KSTACKSIZE 4096  // size of per-process kernel stack
 #define NCPU          8  // maximum number of CPUs
 #define NOFILE       16  // open files per process
@@ -11,4 +11,10 @@
 #define LOGSIZE      (MAXOPBLOCKS*3)  // max data blocks in on-disk log
 #define NBUF         (MAXOPBLOCKS*3)  // size of disk block cache
 #define FSSIZE       2000  // size of file system in blocks
+#define TICKMS       10  // milliseconds per clock tick
+#define TSTACKPAGES   1  // default thread stack pages (plus a guard page)
+#define TSTACKMAX   256  // maximum thread stack pages
+#define NTCACHE       8  // stacks of joined threads a process keeps for reuse
+#define NMLFQ         8  // maximum number of MLFQ priority levels
+#define BALANCE_PERIOD 10  // timer ticks between load balancing passes
 
@@ -0,0 +1,54 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "date.h"
+
+// Two processes pinned to one CPU pass a byte back and forth
+// through a pair of pipes, so each round trip is two switches.
+
+#define NROUND 10000
+
+int
+main(int argc, char *argv[])
+{
+  struct timespec t0, t1;
+  int ping[2], pong[2];
+  int i, pid;
+  uint us;
+  char c = 0;
+
+  if(pipe(ping) < 0 || pipe(pong) < 0){
+    printf(1, "pipe panic\n");
+    exit();
+  }
+  if(sched_setaffinity(0, 1) < 0){
+    printf(1, "sched_setaffinity panic\n");
+    exit();
+  }
+
+  if((pid = fork()) < 0){
+    printf(1, "fork panic\n");
+    exit();
+  }
+  if(pid == 0){
+    for(i = 0; i < NROUND; i++){
+      read(ping[0], &c, 1);
+      write(pong[1], &c, 1);
+    }
+    exit();
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  for(i = 0; i < NROUND; i++){
+    write(ping[1], &c, 1);
+    read(pong[0], &c, 1);
+  }
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  wait();
+
+  // Timed in us, which doesn't wrap on a slow machine; NROUND is a multiple of 1000.
+  us = timespec_diff(&t0, &t1, 1000);
+  printf(1, "%d round trips, %d ns each, %d ns per switch\n",
+         NROUND, us / (NROUND / 1000), us / (NROUND / 1000) / 2);
+  exit();
+}
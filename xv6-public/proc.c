@@ -6,6 +6,10 @@
 #include "x86.h"
 #include "proc.h"
 #include "spinlock.h"
+#include "traps.h"
+#include "schedstat.h"
+#include "schedconf.h"
+#include "trace.h"
 
 /* VARIABLE */
 struct {
@@ -13,6 +17,48 @@ struct {
   struct proc proc[NPROC];
 } ptable;
 
+/* Per-CPU run queues.
+   A RUNNABLE process sits on exactly one run queue: MLFQ processes in the
+   FIFO of their priority level, Stride processes in a min-heap of pass value.
+   ptable.lock must be held to change p->state, and rq->lock to link or unlink. */
+struct runq {
+  struct spinlock lock;
+  struct proc *head[NMLFQ];    // MLFQ queue of each priority level
+  struct proc *tail[NMLFQ];
+  struct proc *heap[NPROC];    // Stride queue, binary min-heap of pass value
+  int nheap;                   // Number of processes in heap
+  volatile int nrun;           // Number of queued processes
+  int balance_ticks;           // Timer ticks since the last load balancing
+  uint nsteal;                 // Number of steal attempts
+  uint nmigrate;               // Number of processes pulled from other CPUs
+  uint64 mlfq_pass_value;      // Used to decide which scheduler to use on this CPU
+  uint64 stride_pass_value;    // Used to decide which scheduler to use on this CPU
+  uint64 stride_vtime;         // Virtual time: pass value of the latest dispatched Stride process
+  uint epoch;                  // Priority boost epoch which MLFQ queues belong to
+  struct proc *gang;           // Gang member to run next, ahead of the queues (see gang_launch)
+  struct proc *edfq;           // EDF queue of released jobs, sorted by deadline
+  int nedf;                    // Number of processes in edfq
+  struct proc *edf_throttled;  // EDF tasks waiting for their next release (not counted in nrun)
+  int edf_util;                // Utilization of EDF tasks admitted to this CPU (per mille)
+  struct proc *edf_tasks;      // EDF tasks admitted to this CPU, linked by edfnext
+} runqs[NCPU];
+
+/* Sleep queues.
+   A SLEEPING process sits on the sleep queue which its chan hashes to,
+   so wakeup() only looks at processes which may sleep on that chan. */
+#define NSLEEPQ 31
+struct sleepq {
+  struct spinlock lock;
+  struct proc *head;
+} sleepqs[NSLEEPQ];
+
+/* Thread index.
+   Threads are hashed by tid from thread_create() until they're joined or reaped,
+   so thread_join() and yield_to() find their target without scanning ptable.
+   Protected by ptable.lock. */
+#define NTIDHASH 61
+struct proc *tidhash[NTIDHASH];
+
 static struct proc *initproc;
 
 int nextpid = 1;
@@ -26,14 +72,27 @@ static void wakeup1(void *chan);
 int boost_check = 0;
 // This variable is for checking whether it's priority boost time. Actually it's total ticks.
 
+uint boost_epoch = 0;
+// This variable counts priority boosts. Boost only increases it, and each process and
+// run queue catches up lazily when it's next charged or used, so boost costs O(1).
+
 int total_tickets = 0;
-// This variable is representing total_tickets(Maximum value is 80).
+// This variable is representing total_tickets(Maximum value is schedconf.stride_cap).
+
+struct schedconf schedconf = {3, {5, 10, 20}, 100, 80};
+// Scheduler tunables: MLFQ levels and their time slices, boost period and Stride share cap.
+// Written by setschedconf() under tickslock and ptable.lock, so holding either one is enough to read it.
 
-int mlfq_pass_value = 0;
-// This variable is used to decide which scheduler to use
+#define EDF_MAXUTIL 900
+// EDF tasks may reserve up to 90% of a CPU. Rest is split between Stride and MLFQ by decide_scheduler().
 
-int stride_pass_value = 0;
-// This variable is used to decide which scheduler to use
+#define EDF_MAXPERIOD 1000000
+// Longest EDF period in ticks, so that edf_util() can't overflow.
+
+#define STRIDE1 (1 << 20)
+// Fixed-point one of stride arithmetic. Stride = STRIDE1 / tickets, so 10% and 15% get different strides.
+// Process which joins or wakes up starts from its CPU's virtual time,
+// so it can't run in a burst to catch up.
 
 /* FUNCTION */
 void priority_manage(struct proc *p);
@@ -44,26 +103,244 @@ int getlev(void);
 /* This function returns current process' priority.
  */
 int set_cpu_share(int share);
-/* This function gets cpu share when it's available situation.(when total tickets are less than 80)
+/* This function gets cpu share when it's available situation.(when total tickets are less than stride cap)
  * @param[int share]        Share is the tickets that user inputs.
  * @return                  returns amount of tickets.
  */
+int getschedstat(struct schedstat *ss);
+/* This function copies scheduler statistics of every process, thread and CPU.
+ * @param[struct schedstat *ss]     Ss is the buffer which statistics are copied to.
+ * @return                          returns 0.
+ */
+int sched_setaffinity(int pid, uint mask);
+/* This function sets CPU affinity. Process is moved when it's queued next time.
+ * @param[int pid]          Pid is the process whose threads all get mask, 0 for the caller only.
+ * @param[uint mask]        Mask has bit i set for each CPU i it may run on.
+ * @return                  returns 0, or -1 if no such process or no such CPU.
+ */
+int sched_getaffinity(int pid);
+/* This function returns CPU affinity.
+ * @param[int pid]          Pid is the process, 0 for the caller.
+ * @return                  returns CPU mask, or -1 if no such process.
+ */
+int sched_deadline(int runtime, int period, int deadline);
+/* This function makes the caller an EDF real-time task, if admission control lets it.
+ * @param[int runtime]          Runtime is the ticks it may run each period.
+ * @param[int period]           Period is the ticks between job releases.
+ * @param[int deadline]         Deadline is the ticks from a job release to its deadline.
+ * @return                      returns 0, or -1 if it isn't admitted.
+ */
+void edf_yield(void);
+/* This function finishes current job of the calling EDF task.
+ */
+static void edf_leave(struct proc *p);
+/* This function gives back the CPU utilization of an exiting EDF task.
+ * @param[struct proc *p]       P is the exiting task.
+ */
+static void edf_push(struct runq *rq, struct proc *p);
+/* This function puts released EDF job on run queue in deadline order.
+ * @param[struct runq *rq]      Rq is the run queue, its lock held.
+ * @param[struct proc *p]       P is the EDF task.
+ */
+void edf_tick(void);
+/* This function counts deadline misses and releases new EDF jobs on current CPU every tick.
+ */
 void add_clock(void);
 /* This function adds time clock(I mean entire time clock. Not process' time clock),
- * and do priority boost at proper time(When total time clock == 100)
+ * and do priority boost at proper time(When total time clock == boost period)
+ */
+int getschedconf(struct schedconf *sc);
+/* This function copies scheduler tunables.
+ * @param[struct schedconf *sc]     Sc is the buffer which tunables are copied to.
+ * @return                          returns 0.
  */
-void stride_realloc(void);
-/* This function adjusts process' stride when total tickets have been changed.
+int setschedconf(struct schedconf *sc);
+/* This function sets scheduler tunables, then boosts priority so that every process
+ * starts from a level that exists.
+ * @param[struct schedconf *sc]     Sc is the new tunables.
+ * @return                          returns 0, or -1 if they're out of range.
  */
-int decide_scheduler(void);
+int decide_scheduler(struct runq *rq);
 /* This function decides which scheduler to use.
+ * @param[struct runq *rq]      Rq is the run queue of current CPU.
  * @return      1 if Stride Scheduler is selected, 0 if MLFQ Scheduler is selected.
  */
+static void mlfq_catchup(struct proc *p);
+/* This function applies priority boost which happened since process was last charged.
+ * @param[struct proc *p]       P is the process which will be checked.
+ */
+static void runq_boost(struct runq *rq);
+/* This function applies priority boost to run queue, moving all MLFQ processes to the highest level.
+ * Caller must hold rq->lock.
+ * @param[struct runq *rq]      Rq is the run queue which will be boosted.
+ */
+static void group_restride(struct proc *g);
+/* This function splits process' tickets among the process and its live threads.
+ * Caller must hold ptable.lock.
+ * @param[struct proc *g]       G is the process (not thread) which owns the CPU share.
+ */
+static void switchproc(struct proc *p, pde_t *pgdir);
+/* This function switches TSS and page table to process p.
+ * @param[struct proc *p]       P is the process which will run.
+ * @param[pde_t *pgdir]         Pgdir is the page table loaded on this CPU.
+ */
+static uint tstack_alloc(struct proc *g, int npages);
+/* This function allocates user stack for a new thread.
+ * @param[struct proc *g]       G is the process which the thread belongs to.
+ * @param[int npages]           Npages is the size of stack in pages, guard page excluded.
+ * @return                      returns base of the stack, or 0.
+ */
+static uint tcache_get(struct proc *g, uint size, char **kstack);
+/* This function takes stacks cached by process g for a new thread.
+ * @param[struct proc *g]       G is the process which the thread belongs to.
+ * @param[uint size]            Size is the size of user stack, guard page included.
+ * @param[out] kstack           Kstack is set to a cached kernel stack, or 0. Null to take none.
+ * @return                      returns base of a cached user stack, or 0.
+ */
+static void tcache_put(struct proc *g, struct proc *t);
+/* This function caches stacks of joined thread t, or frees them.
+ * @param[struct proc *g]       G is the process which t belonged to.
+ * @param[struct proc *t]       T is the joined thread.
+ */
+static void tcache_trim(struct proc *g, uint sz);
+/* This function drops cached user stacks above the end of shrunk process g.
+ * @param[struct proc *g]       G is the process which shrank.
+ * @param[uint sz]              Sz is its new size.
+ */
+static uint tstack_end(struct proc *g);
+/* This function finds the end of the highest user stack owned by a thread of process g,
+ * exited or not, until it is joined. ptable.lock held.
+ * @param[struct proc *g]       G is the process.
+ * @return                      returns the end, or 0 if its threads own no stack.
+ */
+static void tcache_flush(struct proc *g);
+/* This function frees kernel stacks cached by process g.
+ * @param[struct proc *g]       G is the process which is freed.
+ */
+static void tstack_free(struct proc *g, uint base, uint size);
+/* This function frees user stack of a joined thread.
+ * @param[struct proc *g]       G is the process which the thread belonged to.
+ * @param[uint base]            Base is the base of the stack (guard page).
+ * @param[uint size]            Size is the size of the stack, guard page included.
+ */
+static void tid_insert(struct proc *t);
+/* This function adds thread t to the thread index, ptable.lock held.
+ * @param[struct proc *t]       T is the new thread.
+ */
+static struct proc* tid_lookup(int tid);
+/* This function finds thread by its ID, ptable.lock held.
+ * @param[int tid]              Tid is the thread ID.
+ * @return                      returns the thread, or 0 if there's no such thread.
+ */
+static void tid_remove(struct proc *t);
+/* This function takes thread t out of the thread index, ptable.lock held.
+ * @param[struct proc *t]       T is the thread which is freed.
+ */
+static struct sleepq* sleepq_of(void *chan);
+/* This function returns sleep queue which chan hashes to.
+ * @param[void *chan]           Chan is the channel which process sleeps on.
+ */
+static void sleepq_remove(struct proc *p);
+/* This function takes sleeping process out of its sleep queue.
+ * @param[struct proc *p]       P is the sleeping process.
+ */
+static void setrunnable(struct proc *p);
+/* This function changes process' state to RUNNABLE and puts it on a run queue.
+ * Caller must hold ptable.lock.
+ * @param[struct proc *p]       P is the process which will be runnable.
+ */
+static void proc_dispatch(struct proc *p, int charge);
+/* This function makes process the running process of current CPU.
+ * @param[struct proc *p]       P is the process which will run.
+ * @param[int charge]           Charge is 1 to advance its pass value, 0 if it runs on another's slice.
+ */
+int yield_to(int tid);
+/* This function switches directly to a runnable thread of the same process.
+ * @param[int tid]              Tid is the thread which will run the rest of caller's time slice.
+ * @return                      returns 0, or -1 if it isn't a runnable thread which may run on this CPU.
+ */
+static struct proc* runq_next(struct runq *rq, pde_t *pgdir);
+/* This function takes the next process to run from this CPU's run queue.
+ * @param[struct runq *rq]      Rq is the run queue of current CPU.
+ * @param[pde_t *pgdir]         Pgdir is the address space loaded now, 0 if none.
+ * @return                      Next process, or 0 if there is nothing to run.
+ */
+static struct proc* runq_pop(struct runq *rq, int stride, pde_t *pgdir);
+/* This function takes the next process of given class from run queue.
+ * @param[struct runq *rq]      Rq is the run queue to take from.
+ * @param[int stride]           1 to take from Stride queue, 0 to take from MLFQ queues.
+ * @param[pde_t *pgdir]         Pgdir is preferred among equal candidates, 0 if none.
+ * @return                      Next process, or 0 if there is nothing to run.
+ */
+static struct runq* runq_lock(struct proc *p);
+/* This function locks the run queue which holds runnable process p, ptable.lock held.
+ * @param[struct proc *p]       P is the runnable process.
+ * @return                      Run queue of p, its lock held.
+ */
+static int runq_remove(struct runq *rq, struct proc *p);
+/* This function takes runnable process out of run queue.
+ * @param[struct runq *rq]      Rq is the run queue which holds p, its lock held.
+ * @param[struct proc *p]       P is the process to take out.
+ * @return                      1 if it was found, 0 otherwise.
+ */
+static void gang_launch(struct proc *g, struct proc *p);
+/* This function dispatches runnable threads of a gang on other CPUs together.
+ * @param[struct proc *g]       G is the gang's process (thread group leader).
+ * @param[struct proc *p]       P is the gang member which this CPU runs now.
+ */
+int set_gang(int on);
+/* This function turns gang scheduling of the calling process on or off.
+ * @param[int on]               On is nonzero to dispatch its threads together.
+ * @return                      returns 0.
+ */
+static void runq_prefer(struct runq *rq, int stride, pde_t *pgdir);
+/* This function moves a process sharing pgdir to the front among equal candidates.
+ * @param[struct runq *rq]      Rq is the run queue, its lock held.
+ * @param[int stride]           1 for Stride queue, 0 for MLFQ queues.
+ * @param[pde_t *pgdir]         Pgdir is the address space loaded now.
+ */
+static void stride_push(struct runq *rq, struct proc *p);
+/* This function inserts process into Stride heap of run queue.
+ * @param[struct runq *rq]      Rq is the run queue which has the heap.
+ * @param[struct proc *p]       P is the process which will be inserted.
+ */
+static struct proc* stride_pop(struct runq *rq);
+/* This function removes the least pass value process from Stride heap of run queue.
+ * @param[struct runq *rq]      Rq is the run queue which has the heap.
+ * @return                      Removed process, or 0 if heap is empty.
+ */
+static void mlfq_push(struct runq *rq, struct proc *p);
+/* This function appends process to MLFQ queue of its priority level.
+ * @param[struct runq *rq]      Rq is the run queue which has the MLFQ queues.
+ * @param[struct proc *p]       P is the process which will be appended.
+ */
+static struct proc* mlfq_pop(struct runq *rq, int level);
+/* This function removes the first process of MLFQ queue of given level.
+ * @param[struct runq *rq]      Rq is the run queue which has the MLFQ queues.
+ * @param[int level]            Level is the priority level of queue.
+ * @return                      Removed process, or 0 if queue is empty.
+ */
+static int runq_movable(struct runq *rq);
+/* This function counts queued processes which load balancing may pull from run queue.
+ * @param[struct runq *rq]      Rq is the run queue, read without its lock.
+ * @return                      Number of processes in its Stride and MLFQ queues.
+ */
+static int runq_balance(struct runq *rq);
+/* This function pulls a batch of processes from the busiest CPU's run queue.
+ * @param[struct runq *rq]      Rq is the run queue which receives processes.
+ * @return                      Number of pulled processes.
+ */
 
 void
 pinit(void)
 {
+  int i;
+
   initlock(&ptable.lock, "ptable");
+  for(i = 0; i < NCPU; i++)
+    initlock(&runqs[i].lock, "runq");
+  for(i = 0; i < NSLEEPQ; i++)
+    initlock(&sleepqs[i].lock, "sleepq");
 }
 
 //PAGEBREAK: 32
@@ -71,12 +348,12 @@ pinit(void)
 // If found, change state to EMBRYO and initialize
 // state required to run in the kernel.
 // Otherwise return 0.
+// Kernel stack is kstack if it isn't 0 (see tcache_get).
 static struct proc*
-allocproc(void)
+allocproc(char *kstack)
 {
   struct proc *p;
   char *sp;
-  int i;
 
   acquire(&ptable.lock);
 
@@ -93,11 +370,28 @@ found:
   p->pid = nextpid++;
   // Thread ID initialize.
   p->tid = -1;
+  p->rqnext = 0;
+  p->skipped = 0;
+  p->gang = 0;
+  p->gangslice = 0;
+  p->edf = 0;
+  p->edf_nmiss = 0;
+  p->lastcpu = -1;
+  p->cpumask = ~0;
+  p->nmigrate = 0;
+  memset(p->rticks, 0, sizeof(p->rticks));
+  p->sticks = 0;
+  p->nvcsw = 0;
+  p->nivcsw = 0;
+  p->wait_ns = 0;
+  p->kscache = 0;
+  p->nkscache = 0;
+  p->ntscache = 0;
 
   release(&ptable.lock);
 
   // Allocate kernel stack.
-  if((p->kstack = kalloc()) == 0){
+  if((p->kstack = kstack) == 0 && (p->kstack = kalloc()) == 0){
     p->state = UNUSED;
     return 0;
   }
@@ -121,6 +415,7 @@ found:
   // /* Initialize process' attributes */ //
 
   p->priority = 0;
+  p->epoch = boost_epoch;
   // Priority level starts from 0. 0 is the Highest level, 2 is the lowest level.
 
   p->ticks = 0;
@@ -131,11 +426,9 @@ found:
   p->tickets = 0;
   p->stride = 0;
   p->pass_value = 0;
-  
-  // Initialize tspace.
-  for(i = 0; i < 10; i++){
-        p->tspace[i] = 0;      
-  }
+  p->remain = 0;
+  p->nthreads = 0;
+  p->tlbgen = 0;
 
   return p;
 }
@@ -147,7 +440,7 @@ userinit(void)
   struct proc *p;
   extern char _binary_initcode_start[], _binary_initcode_size[];
 
-  p = allocproc();
+  p = allocproc(0);
   initproc = p;
   if((p->pgdir = setupkvm()) == 0)
     panic("userinit: out of memory?");
@@ -172,7 +465,7 @@ userinit(void)
   // because the assignment might not be atomic.
   acquire(&ptable.lock);
 
-  p->state = RUNNABLE;
+  setrunnable(p);
 
   release(&ptable.lock);
 }
@@ -191,8 +484,14 @@ growproc(int n)
         if((sz = allocuvm(proc->pgdir, sz, sz + n)) == 0)
             return -1;
     } else if(n < 0){
-        if((sz = deallocuvm(proc->pgdir, sz, sz + n)) == 0)
+        acquire(&ptable.lock);
+        if(sz + n < tstack_end(proc->parent) || (sz = deallocuvm(proc->pgdir, sz, sz + n)) == 0){
+            release(&ptable.lock);
             return -1;
+        }
+        proc->parent->tlbgen++;
+        tcache_trim(proc->parent, sz);
+        release(&ptable.lock);
     }
     proc->parent->sz = sz;
   }
@@ -202,8 +501,14 @@ growproc(int n)
         if((sz = allocuvm(proc->pgdir, sz, sz + n)) == 0)
             return -1;
     } else if(n < 0){
-        if((sz = deallocuvm(proc->pgdir, sz, sz + n)) == 0)
+        acquire(&ptable.lock);
+        if(sz + n < tstack_end(proc) || (sz = deallocuvm(proc->pgdir, sz, sz + n)) == 0){
+            release(&ptable.lock);
             return -1;
+        }
+        proc->tlbgen++;
+        tcache_trim(proc, sz);
+        release(&ptable.lock);
     }
     proc->sz = sz;
   }
@@ -221,7 +526,7 @@ fork(void)
   struct proc *np;
 
   // Allocate process.
-  if((np = allocproc()) == 0){
+  if((np = allocproc(0)) == 0){
     return -1;
   }
 
@@ -261,11 +566,12 @@ fork(void)
   np->cwd = idup(proc->cwd);
 
   safestrcpy(np->name, proc->name, sizeof(proc->name));
+  np->cpumask = proc->edf ? ~0 : proc->cpumask;
 
   pid = np->pid;
   acquire(&ptable.lock);
   
-  np->state = RUNNABLE;
+  setrunnable(np);
   release(&ptable.lock);
 
   return pid;
@@ -302,6 +608,8 @@ exit(void)
 
     // Parent might be sleeping in wait().
     wakeup1(proc->parent);
+    // Joiner might be sleeping in thread_join().
+    wakeup1(&proc->ret_val);
 
     // Pass abandoned children to init.
     // Change all threads' state that process has.
@@ -314,6 +622,11 @@ exit(void)
     }
     // Kill thread's parent(Process)
     proc->parent->killed = 1;
+
+    // Remaining threads share the process' CPU share.
+    proc->parent->nthreads--;
+    group_restride(proc->parent);
+    trace(TR_TEXIT, proc, proc->parent->pid);
   }
   // When process calls exit().
   else{
@@ -328,7 +641,8 @@ exit(void)
             p->killed = 1;
 
             if(p->state == SLEEPING){
-                p->state = RUNNABLE;
+                sleepq_remove(p);
+                setrunnable(p);
                 continue;
             }
         }
@@ -341,20 +655,17 @@ exit(void)
   }
   // Jump into the scheduler, never to return.
   proc->state = ZOMBIE;
+  edf_leave(proc);
 
   /* Adjust current process'(This will be terminated) attributes. */
   if(proc->tickets > 0){
-    total_tickets -= proc->tickets;
-    // Change total tickets.
+    if(proc->tid == -1)
+        total_tickets -= proc->tickets;
+    // Change total tickets. Only process owns tickets, its threads share them.
 
     proc->tickets = 0;
     proc->stride = 0;
     proc->pass_value = 0;
-
-    /* Total tickets has been changed, so call stride_realloc(). */
-    if(total_tickets > 0){
-        stride_realloc();
-    }   
   }
 
   sched();
@@ -375,6 +686,7 @@ wait(void)
     havekids = 0;
     for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
       if(p->parent->state == ZOMBIE && p->state == ZOMBIE && p->tid > 0){
+        tid_remove(p);
         kfree(p->kstack);
         p->kstack = 0;
         p->pid = 0;
@@ -392,6 +704,7 @@ wait(void)
         pid = p->pid;
         kfree(p->kstack);
         p->kstack = 0;
+        tcache_flush(p);
         freevm(p->pgdir);
         p->pid = 0;
         p->parent = 0;
@@ -425,85 +738,58 @@ wait(void)
 void
 scheduler(void)
 {
-    struct proc *p; 
-    struct proc ref;
-    int level, ps_val, i;
-
-    for(;;){
-        level = 2;
-        ps_val = 0;
-
-        sti();
-
-        /* In scheduler function, first it decides which scheduelr to use.
-           Function decide_scheduler() returns 1 when it comes to use Stride Scheduler.
-           It returns 0 when it comes to use MLFQ Scheduler. */
+    struct proc *p;
+    struct runq *rq;
+    pde_t *pgdir;
+    int i;
 
-        /* Stride Scheduling */
-        if(decide_scheduler()){
-            acquire(&ptable.lock);
+    rq = &runqs[cpu - cpus];
 
-            for(i = 0, ref = ptable.proc[i]; i < NPROC; ref = ptable.proc[i++]){
-                if(ref.state == RUNNABLE && ref.tickets != 0){
-                    ps_val = ref.pass_value;
+    for(;;){
+        /* Nothing is runnable here, and nothing can be pulled from another CPU:
+           EDF jobs and gang members stay where they are queued, and balancing leaves
+           processes whose affinity excludes this CPU. Check it without ptable.lock,
+           so that idle CPUs don't fight for the lock with working ones,
+           and halt until the timer or a reschedule IPI (see setrunnable) comes.
+           Idle flag is set before checking, so a waker either sees it or we see its process. */
+        cli();
+        xchg(&cpu->idle, 1);
+        if(rq->nrun == 0){
+            for(i = 0; i < ncpu; i++){
+                if(runq_movable(&runqs[i]) > 0)
                     break;
-                }
-            } 
-            // Search reference pass value. 
-            
-            for(i = 0, ref = ptable.proc[i]; i < NPROC; ref = ptable.proc[i++]){
-                if(ref.state == RUNNABLE && ref.tickets != 0 && ref.pass_value < ps_val){
-                    ps_val = ref.pass_value;
-                }
             }
-            // Decide pass value. Pass value must be the least one.
-
-            for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-                if(p->state != RUNNABLE || p->pass_value != ps_val){
-                    continue;
-                }
-
-                p->pass_value += p->stride;
-                // Manage pass value.
-
-                proc = p;
-                switchuvm(p);
-                p->state = RUNNING;
-                swtch(&cpu->scheduler, p->context);
-                switchkvm();
-                // Process is done running for now.
-                // It should have changed its p->state before coming back.
-                proc = 0;
-            }
-            // Search selected process, then schedule it.
+            if(i == ncpu || runq_balance(rq) == 0)
+                stihlt();
         }
-        
-        /* MLFQ Scheduling */
-        else{
-            acquire(&ptable.lock);
+        cpu->idle = 0;
+        sti();
 
-            for(i = 0, ref = ptable.proc[i]; i < NPROC; ref = ptable.proc[i++]){
-                if(ref.state == RUNNABLE && ref.tickets == 0  && ref.priority < level){
-                    level = ref.priority;
-                }
-            }
-            // Decide process' priority. It  must be the least one. 
+        if(rq->nrun == 0)
+            continue;
 
-            for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-                if(p->state != RUNNABLE || p->tickets != 0 ||p->priority != level){
-                    continue;
-                }
-                proc = p;
-                switchuvm(p);
-                p->state = RUNNING;
-                swtch(&cpu->scheduler, p->context);
-                switchkvm();
-                // Process is done running for now.
-                // It should have changed its p->state before coming back.
-                proc = 0;
-            }
-            // Search selected process, then schedule it.
+        acquire(&ptable.lock);
+
+        /* Run processes of this run queue back to back, without releasing ptable.lock in between.
+           Kernel is mapped in every pgdir, so %cr3 keeps the last process' pgdir until
+           the next process needs another one; threads of one process skip the reload (and TLB flush).
+           Pgdir can't be freed meanwhile, because wait() frees it with ptable.lock held. */
+        pgdir = 0;
+        while((p = runq_next(rq, pgdir)) != 0){
+            proc_dispatch(p, 1);
+            switchproc(p, pgdir);
+            swtch(&cpu->scheduler, p->context);
+
+            // Process is done running for now.
+            // It should have changed its p->state before coming back.
+            // (It may be another one, which p switched to directly by yield_to.)
+            p = proc;
+            pgdir = p->pgdir;
+            trace(TR_SWITCHOUT, p, p->state);
+            proc = 0;
         }
+        if(pgdir)
+            switchkvm();
 
         release(&ptable.lock);
     }
@@ -516,10 +802,14 @@ scheduler(void)
 // be proc->intena and proc->ncli, but that would
 // break in the few places where a lock is held but
 // there's no process.
+// When this CPU's run queue has work, switch straight
+// to the next process instead of going through
+// the scheduler context (and back out again).
 void
 sched(void)
 {
   int intena;
+  struct proc *p, *old;
 
   if(!holding(&ptable.lock))
     panic("sched ptable.lock");
@@ -530,7 +820,17 @@ sched(void)
   if(readeflags()&FL_IF)
     panic("sched interruptible");
   intena = cpu->intena;
-  swtch(&proc->context, cpu->scheduler);
+  old = proc;
+  if((p = runq_next(&runqs[cpu - cpus], old->pgdir)) == 0)
+    swtch(&old->context, cpu->scheduler);
+  else if(p == old)
+    proc_dispatch(p, 1);  // the only one to run, keep running
+  else {
+    trace(TR_SWITCHOUT, old, old->state);
+    proc_dispatch(p, 1);
+    switchproc(p, old->pgdir);
+    swtch(&old->context, p->context);
+  }
   cpu->intena = intena;
 }
 
@@ -541,14 +841,32 @@ yield(int timer_interrupt)
   /* If yield is called from timer_interrupt,
      you must manage process' time clock. */
 
-  if(timer_interrupt){
-    proc->ticks++;
-    priority_manage(proc);
-    // Add process' time clock, then manage it.
-  }
+  struct proc *g;
 
   acquire(&ptable.lock);  //DOC: yieldlock
-  proc->state = RUNNABLE;
+
+  if(timer_interrupt && proc->edf){
+    proc->edf_budget--;
+    proc->nivcsw++;
+  }
+  else if(timer_interrupt){
+    if(proc->tickets > 0)
+      proc->sticks++;
+    else
+      proc->rticks[proc->priority]++;
+    proc->nivcsw++;
+
+    g = proc->tid > 0 ? proc->parent : proc;
+    mlfq_catchup(g);
+    g->ticks++;
+    priority_manage(g);
+    proc->priority = g->priority;
+    // Add time clock of thread's process, then manage it.
+    // All threads of a process use up one time slice together,
+    // so a process can't get more MLFQ time by making more threads.
+  }
+
+  setrunnable(proc);
   sched();
   release(&ptable.lock);
 }
@@ -585,19 +903,40 @@ sleep(void *chan, struct spinlock *lk)
   if(lk == 0)
     panic("sleep without lk");
 
+  struct sleepq *sq;
+
   // Must acquire ptable.lock in order to
   // change p->state and then call sched.
   // Once we hold ptable.lock, we can be
   // guaranteed that we won't miss any wakeup
   // (wakeup runs with ptable.lock locked),
   // so it's okay to release lk.
-  if(lk != &ptable.lock){  //DOC: sleeplock0
+  // Join the sleep queue before releasing lk:
+  // wakeup() skips empty sleep queues without ptable.lock.
+  if(lk != &ptable.lock)  //DOC: sleeplock0
     acquire(&ptable.lock);  //DOC: sleeplock1
+
+  proc->chan = chan;
+  sq = sleepq_of(chan);
+  acquire(&sq->lock);
+  proc->sqnext = sq->head;
+  sq->head = proc;
+  release(&sq->lock);
+
+  if(lk != &ptable.lock)
     release(lk);
+
+  // Remember how far ahead of virtual time it is.
+  // (It can't bank credit while sleeping, so never behind.)
+  if(proc->tickets > 0){
+    if(proc->pass_value > runqs[cpu - cpus].stride_vtime)
+      proc->remain = proc->pass_value - runqs[cpu - cpus].stride_vtime;
+    else
+      proc->remain = 0;
   }
 
   // Go to sleep.
-  proc->chan = chan;
+  proc->nvcsw++;
   proc->state = SLEEPING;
   sched();
 
@@ -612,27 +951,80 @@ sleep(void *chan, struct spinlock *lk)
 }
 
 //PAGEBREAK!
+// Wake up at most n processes sleeping on chan.
+// Returns how many were woken.
+// The ptable lock must be held.
+static int
+wakeupn1(void *chan, int n)
+{
+  struct sleepq *sq;
+  struct proc *p, **pp, *woken;
+  int nwoken;
+
+  // Take processes sleeping on chan out of the sleep queue,
+  // then make them runnable. (setrunnable takes run queue locks.)
+  woken = 0;
+  nwoken = 0;
+  sq = sleepq_of(chan);
+  acquire(&sq->lock);
+  for(pp = &sq->head; (p = *pp) != 0 && nwoken < n; ){
+    if(p->chan == chan){
+      *pp = p->sqnext;
+      p->sqnext = woken;
+      woken = p;
+      nwoken++;
+    } else
+      pp = &p->sqnext;
+  }
+  release(&sq->lock);
+
+  while((p = woken) != 0){
+    woken = p->sqnext;
+    p->sqnext = 0;
+    setrunnable(p);
+  }
+  return nwoken;
+}
+
 // Wake up all processes sleeping on chan.
 // The ptable lock must be held.
 static void
 wakeup1(void *chan)
 {
-  struct proc *p;
-
-  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++)
-    if(p->state == SLEEPING && p->chan == chan)
-      p->state = RUNNABLE;
+  wakeupn1(chan, NPROC);
 }
 
 // Wake up all processes sleeping on chan.
+// Sleeper joins the sleep queue before it releases the lock
+// which the caller holds, so an empty sleep queue means
+// nobody sleeps on chan, and ptable.lock isn't needed.
 void
 wakeup(void *chan)
 {
+  if(sleepq_of(chan)->head == 0)
+    return;
+
   acquire(&ptable.lock);
   wakeup1(chan);
   release(&ptable.lock);
 }
 
+// Wake up at most n processes sleeping on chan.
+// Returns how many were woken.
+int
+wakeupn(void *chan, int n)
+{
+  int nwoken;
+
+  if(sleepq_of(chan)->head == 0)
+    return 0;
+
+  acquire(&ptable.lock);
+  nwoken = wakeupn1(chan, n);
+  release(&ptable.lock);
+  return nwoken;
+}
+
 // Kill the process with the given pid.
 // Process won't exit until it returns
 // to user space (see trap in trap.c).
@@ -646,8 +1038,10 @@ kill(int pid)
     if(p->pid == pid){
         p->killed = 1;
         // Wake process from sleep if necessary.
-        if(p->state == SLEEPING)
-            p->state = RUNNABLE;
+        if(p->state == SLEEPING){
+            sleepq_remove(p);
+            setrunnable(p);
+        }
         release(&ptable.lock);
         return 0;
     }
@@ -691,203 +1085,1422 @@ procdump(void)
     }
     cprintf("\n");
   }
-}
 
-/* This function manages argument process's priority. */
-void
-priority_manage(struct proc *p)
-{
-  switch (p->priority) {
-      case 0 :
-          if(p->ticks == 5){
-              p->priority++;        
-              p->ticks = 0;
-          }
-          // In case of priority 0 -> 1
-      break;
-
-      case 1 :
-          if(p->ticks == 10){
-              p->priority++;        
-              p->ticks = 0;
-          }
-          // In case of priority 1 -> 2
-      break;
- 
-      case 2 :
-          if(p->ticks == 20){
-              p->ticks = 0;
-          }
-          //In case of priority 2 -> 2
-      break;
-  }
+  for(i = 0; i < ncpu; i++)
+    cprintf("cpu%d: queued %d, steal %d, migrate %d, idle %d\n",
+            i, runqs[i].nrun, runqs[i].nsteal, runqs[i].nmigrate, cpus[i].idleticks);
 }
 
-/* This function returns current process' priority. */
+/* This function copies scheduler statistics of every process, thread and CPU to ss. */
 int
-getlev(void)
+getschedstat(struct schedstat *ss)
 {
-    return proc->priority;
-}
+    struct procstat *ps;
+    struct proc *p;
+    int i;
 
-/* This function set process' tickets, stride, and initialize pass value. */
-int
-set_cpu_share(int share)
-{
-    if(share <= 0){
+    acquire(&ptable.lock);
 
-        return -1;           
+    ss->nproc = 0;
+    for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
+        if(p->state == UNUSED)
+            continue;
+        ps = &ss->proc[ss->nproc++];
+        ps->pid = p->pid;
+        ps->tid = p->tid;
+        ps->state = p->state;
+        safestrcpy(ps->name, p->name, sizeof(ps->name));
+        ps->priority = p->priority;
+        for(i = 0; i < NMLFQ; i++)
+            ps->rticks[i] = p->rticks[i];
+        ps->sticks = p->sticks;
+        ps->tickets = p->tickets;
+        ps->stride = p->stride;
+        ps->pass_value = p->pass_value;
+        ps->nvcsw = p->nvcsw;
+        ps->nivcsw = p->nivcsw;
+        ps->wait_us = divu64(p->wait_ns, 1000, 0);
+        ps->lastcpu = p->lastcpu;
+        ps->cpumask = p->cpumask;
+        ps->nmigrate = p->nmigrate;
+        ps->edf = p->edf;
+        ps->edf_nmiss = p->edf_nmiss;
     }
-    // When argument is below 0, returns -1(Error).
-
-    else{
-        if(total_tickets + share <= 80){
-        // First, check if total tickets become 80(Limitation).
-            
-            /* Set process' tickets, pass value, and reinitialize total tickets. */
-            proc->tickets = share;
-            total_tickets += share;
-            proc->pass_value = 0;
-
-            /* Reinitialize all process' stride. */
-            acquire(&ptable.lock);
-            stride_realloc();
-            release(&ptable.lock);
 
-            return share;
-        }
-        else{
-            return -1;
-        }
-        // When total tickets become over 80, block the input.
+    ss->ncpu = ncpu;
+    for(i = 0; i < ncpu; i++){
+        ss->cpu[i].busyticks = cpus[i].busyticks;
+        ss->cpu[i].idleticks = cpus[i].idleticks;
+        ss->cpu[i].nrun = runqs[i].nrun;
     }
-    // When argument is above 0.
+
+    release(&ptable.lock);
+    return 0;
 }
 
-/* This function adds total clock, and boosts priority when it needs. */
-void
-add_clock(void)
+/* This function sets CPU affinity of the calling process or thread (pid 0),
+   or of process pid and all of its threads. */
+int
+sched_setaffinity(int pid, uint mask)
 {
-    boost_check++;
-    
-    /* When it comes to priority boost situation. */
-    if(boost_check == 100){
-        struct proc ref;
-        int i;
+    struct proc *p;
+    int found;
 
-        acquire(&ptable.lock);
+    mask &= (1 << ncpu) - 1;
+    if(mask == 0)
+        return -1;
 
-        for(i = 0, ref = ptable.proc[i]; i < NPROC; ref = ptable.proc[i++]){
-            ref.priority = 0;
-            ref.ticks = 0;
+    // EDF tasks stay on the CPU they were admitted to.
+    acquire(&ptable.lock);
+    if(pid == 0){
+        found = !proc->edf;
+        if(found)
+            proc->cpumask = mask;
+    }
+    else{
+        found = 0;
+        for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
+            if(p->pid == pid && p->state != UNUSED && p->state != ZOMBIE && !p->edf){
+                p->cpumask = mask;
+                found = 1;
+            }
         }
-        // Reset all process' priority and time clock.
-              
-        release(&ptable.lock);
+    }
+    release(&ptable.lock);
 
-        boost_check = 0;
+    // Leave this CPU if it's no longer allowed; setrunnable() picks an allowed one.
+    if(found && !(proc->cpumask & (1 << proc->lastcpu)))
+        yield(0);
 
-        /* Useless cod e*/
-        i = ref.priority;
-        // To avoid "unused but set problem".
-    }
+    return found ? 0 : -1;
 }
 
-/* This function reinitialize all process' stride.
-   When total tickets change, all process' stride must be changed. */
-void
-stride_realloc(void)
+/* This function returns CPU affinity of the calling process or thread (pid 0), or of process pid. */
+int
+sched_getaffinity(int pid)
 {
     struct proc *p;
+    int mask;
 
+    if(pid == 0)
+        return proc->cpumask & ((1 << ncpu) - 1);
+
+    mask = -1;
+    acquire(&ptable.lock);
     for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-        if(p->tickets > 0){
-            p->stride = total_tickets / p->tickets;
-            // Process' stride = Total tickets / Process' tickets
+        if(p->pid == pid && p->tid == -1 && p->state != UNUSED){
+            mask = p->cpumask & ((1 << ncpu) - 1);
+            break;
         }
     }
+    release(&ptable.lock);
+    return mask;
 }
 
-/* This function decides which scheduler to use.
-   In this function, I apply Stride algorithm once more. */
-int
-decide_scheduler(void)
+/* EDF per mille utilization of runtime every period, rounded up.
+   Period is at most EDF_MAXPERIOD, so it fits in int. */
+static int
+edf_util(int runtime, int period)
 {
-    int mlfq_stride, stride_stride;
+    return (runtime * 1000 + period - 1) / period;
+}
 
-    if(total_tickets){
-    /* In every case total tickets are 100(CPU share 100%).
-       Each Scheduler's stride = 100 / Scheduler's tickets.
+/* This function makes the calling process or thread an EDF task, which runs
+   runtime ticks every period ticks, each job done within deadline ticks of its release.
+   It's admitted to the CPU with the least EDF utilization which can still take it, and pinned there. */
+int
+sched_deadline(int runtime, int period, int deadline)
+{
+    int i, c, util;
 
-       Stride Scheduler's tickets : Total tickets which used in 
-                                    Stride Scheduler. (Limitation : 80)
+    if(runtime <= 0 || runtime > deadline || deadline > period || period > EDF_MAXPERIOD)
+        return -1;
+    util = edf_util(runtime, period);
+    if(util > 1000)
+        return -1;
 
-       MLFQ Scheduler's tickests : 100 - Stride Scheduler's tickets. */
+    acquire(&ptable.lock);
 
-        stride_stride = 100 / total_tickets;
-        mlfq_stride = 100 / (100 - total_tickets);
+    c = -1;
+    for(i = 0; i < ncpu; i++){
+        if(runqs[i].edf_util + util <= EDF_MAXUTIL && (c < 0 || runqs[i].edf_util < runqs[c].edf_util))
+            c = i;
     }
-
-    /* If there is no process which will be scheduled in Stride Scheduler,
-       (This means total tickets are 0) select MLFQ Scheduler */
-    else{
-        return 0;
+    if(c < 0 || proc->edf || proc->tickets > 0){
+        release(&ptable.lock);
+        return -1;
     }
+    // Admission control: utilization of each CPU stays within EDF_MAXUTIL.
+
+    runqs[c].edf_util += util;
+    proc->edf = 1;
+    proc->edf_cpu = c;
+    proc->edf_runtime = runtime;
+    proc->edf_period = period;
+    proc->edf_deadline = deadline;
+    proc->edf_release = ticks;
+    proc->edf_budget = runtime;
+    proc->edf_done = 0;
+    proc->edf_nmiss = 0;
+    proc->cpumask = 1 << c;
+
+    acquire(&runqs[c].lock);
+    proc->edfnext = runqs[c].edf_tasks;
+    runqs[c].edf_tasks = proc;
+    release(&runqs[c].lock);
 
-    /* Select scheduler whose pass value is less than the other's. */
+    release(&ptable.lock);
 
-    if(stride_pass_value <= stride_pass_value){
-        stride_pass_value += stride_stride;    
-        return 1;
-    }
-    // When Stride Scheduler is selected.
+    // Go to the EDF queue of its CPU.
+    yield(0);
+    return 0;
+}
 
-    else{
-        mlfq_pass_value += mlfq_stride;
-        return 0;
-    }
-    // When MLFQ Scheduler is selected.
+/* This function finishes current job of the calling EDF task. It waits for its next release. */
+void
+edf_yield(void)
+{
+    acquire(&ptable.lock);
+    proc->edf_done = 1;
+    release(&ptable.lock);
+    yield(0);
 }
-/* Thread Function */
 
-/* This function creates thread with given argument(arg).
- * Then saves its thread id in given argument(thread).
- * @param[out]    thread           ID of new thread
- * @param[in]     start_routine    Thread function to execute(main function of new thread)
- * @param[in]     arg              argument pass to start_routine
- * return                          If souccess 0, else -1
- */
-int
-thread_create(thread_t *thread, void *(*start_routine)(void *), void *arg)
+/* This function gives back the utilization of an exiting EDF task, ptable.lock held. */
+static void
+edf_leave(struct proc *p)
 {
-    int i,espace = -1;
+    struct runq *rq;
+    struct proc **pp;
+
+    if(!p->edf)
+        return;
+    rq = &runqs[p->edf_cpu];
+    acquire(&rq->lock);
+    for(pp = &rq->edf_tasks; *pp; pp = &(*pp)->edfnext){
+        if(*pp == p){
+            *pp = p->edfnext;
+            break;
+        }
+    }
+    release(&rq->lock);
+    rq->edf_util -= edf_util(p->edf_runtime, p->edf_period);
+    p->edf = 0;
+}
 
-    struct proc *nt, *tparent;
-    uint sp, ustack[2];
+/* This function puts released EDF job on run queue in deadline order, rq->lock held. */
+static void
+edf_push(struct runq *rq, struct proc *p)
+{
+    struct proc **pp;
+    uint dl;
+
+    dl = p->edf_release + p->edf_deadline;
+    for(pp = &rq->edfq; *pp && (int)((*pp)->edf_release + (*pp)->edf_deadline - dl) <= 0; pp = &(*pp)->rqnext)
+        ;
+    p->rqnext = *pp;
+    *pp = p;
+    rq->nedf++;
+}
 
-    /* kernel stack */
+/* This function counts deadline misses and releases new jobs of EDF tasks on this CPU.
+   Called by the timer interrupt every tick. It walks only the tasks admitted here, under rq->lock;
+   their jobs are otherwise changed only by themselves, pinned to this CPU with interrupts off. */
+void
+edf_tick(void)
+{
+    struct runq *rq;
+    struct proc *p, **pp;
+
+    rq = &runqs[cpu - cpus];
+    if(rq->edf_util == 0)
+        return;
+
+    acquire(&rq->lock);
+    for(p = rq->edf_tasks; p; p = p->edfnext){
+        // Job is not done by its deadline. If it's queued, it waits for the next release.
+        if(!p->edf_done && (int)(ticks - (p->edf_release + p->edf_deadline)) >= 0){
+            p->edf_nmiss++;
+            p->edf_done = 1;
+            for(pp = &rq->edfq; *pp; pp = &(*pp)->rqnext){
+                if(*pp == p){
+                    *pp = p->rqnext;
+                    p->rqnext = rq->edf_throttled;
+                    rq->edf_throttled = p;
+                    rq->nedf--;
+                    rq->nrun--;
+                    break;
+                }
+            }
+        }
 
-    // Allocate thread
-    if((nt = allocproc()) == 0){
-        return -1;
+        // Release next job.
+        if((int)(ticks - (p->edf_release + p->edf_period)) >= 0){
+            while((int)(ticks - (p->edf_release + p->edf_period)) >= 0)
+                p->edf_release += p->edf_period;
+            p->edf_budget = p->edf_runtime;
+            p->edf_done = 0;
+            for(pp = &rq->edf_throttled; *pp; pp = &(*pp)->rqnext){
+                if(*pp == p){
+                    *pp = p->rqnext;
+                    edf_push(rq, p);
+                    rq->nrun++;
+                    break;
+                }
+            }
+        }
     }
+    release(&rq->lock);
+}
 
-    // Initialize thread ID.
-    nt->tid = nexttid++;
+/* This function manages argument process's priority. */
+void
+priority_manage(struct proc *p)
+{
+  if(p->ticks < schedconf.quantum[p->priority])
+      return;
 
-    // When thread calls thread_create. Including nested case.
-    tparent = proc;
-    while(tparent->tid > 0){
-        tparent = tparent->parent;
-    }
-    nt->parent = tparent;
+  p->ticks = 0;
+  if(p->priority < schedconf.nlevel - 1){
+      p->priority++;
+      trace(TR_DEMOTE, p, p->priority);
+  }
+  // Process which used up its time slice goes one level down, except at the lowest level.
+}
 
-    // Allocate tickets
-    if(tparent->tickets){
-        nt->tickets = tparent->tickets;
-        nt->stride = tparent->stride;
-        nt->pass_value = tparent->pass_value;
-    }
+/* This function returns current process' priority. */
+int
+getlev(void)
+{
+    mlfq_catchup(proc);
+    return proc->priority;
+}
+
+/* This function set process' tickets, stride, and initialize pass value.
+   When thread calls it, the share is set for its process, and all threads of the process share it. */
+int
+set_cpu_share(int share)
+{
+    struct runq *rq;
+    struct proc *g;
+    int remain, stride;
+
+    if(share <= 0){
+
+        return -1;           
+    }
+    // When argument is below 0, returns -1(Error).
+
+    acquire(&ptable.lock);
+
+    g = proc->tid > 0 ? proc->parent : proc;
+
+    if(proc->edf || total_tickets - g->tickets + share > schedconf.stride_cap){
+        release(&ptable.lock);
+        return -1;
+    }
+    // When total tickets become over stride cap, block the input.
+
+    rq = &runqs[cpu - cpus];
+    stride = proc->stride;
+
+    /* Set process' tickets, then split them among its threads. */
+    total_tickets += share - g->tickets;
+    g->tickets = share;
+    group_restride(g);
+
+    /* Process which changes its share keeps its distance to virtual time, scaled to new stride.
+       Process which newly joins starts one stride ahead of virtual time. */
+    if(stride > 0 && proc->pass_value > rq->stride_vtime){
+        remain = proc->pass_value - rq->stride_vtime;
+        if(remain > stride)
+            remain = stride;
+        remain = (proc->stride >> 10) * (remain / (stride >> 10));
+        // Scale it in 1/1024 units of stride, so that it doesn't overflow 32 bits.
+    }
+    else{
+        remain = proc->stride;
+    }
+    proc->pass_value = rq->stride_vtime + remain;
+    trace(TR_SHARE, g, share);
+
+    release(&ptable.lock);
+
+    return share;
+}
+
+/* This function adds total clock, and boosts priority when it needs. */
+void
+add_clock(void)
+{
+    boost_check++;
+    
+    /* When it comes to priority boost situation.
+       Processes and run queues catch up with it lazily (see mlfq_catchup() and runq_boost()). */
+    if(boost_check >= schedconf.boost){
+        boost_epoch++;
+        boost_check = 0;
+        trace(TR_BOOST, 0, boost_epoch);
+    }
+}
+
+/* This function copies scheduler tunables. */
+int
+getschedconf(struct schedconf *sc)
+{
+    acquire(&ptable.lock);
+    *sc = schedconf;
+    release(&ptable.lock);
+
+    return 0;
+}
+
+/* This function sets scheduler tunables.
+   Lowering the stride cap below tickets already given out is refused.
+   Cap stays below 100, so that MLFQ always keeps some share (see decide_scheduler()). */
+int
+setschedconf(struct schedconf *sc)
+{
+    int i;
+
+    if(sc->nlevel < 1 || sc->nlevel > NMLFQ || sc->boost <= 0 ||
+       sc->stride_cap < 1 || sc->stride_cap > 99)
+        return -1;
+    for(i = 0; i < sc->nlevel; i++){
+        if(sc->quantum[i] <= 0)
+            return -1;
+    }
+
+    // Tickslock comes first, as in sleep(&ticks, &tickslock).
+    acquire(&tickslock);
+    acquire(&ptable.lock);
+    if(sc->stride_cap < total_tickets){
+        release(&ptable.lock);
+        release(&tickslock);
+        return -1;
+    }
+    schedconf = *sc;
+
+    /* Boost now, so that processes on levels which are gone get back to level 0. */
+    boost_epoch++;
+    boost_check = 0;
+    trace(TR_BOOST, 0, boost_epoch);
+
+    release(&ptable.lock);
+    release(&tickslock);
+
+    return 0;
+}
+
+/* This function resets process' priority and time clock if priority boost happened. */
+static void
+mlfq_catchup(struct proc *p)
+{
+    if(p->epoch != boost_epoch){
+        p->priority = 0;
+        p->ticks = 0;
+        p->epoch = boost_epoch;
+    }
+}
+
+/* This function moves queued processes to the highest level queue.
+   Each moved process resets its own priority later, in mlfq_catchup(). */
+static void
+runq_boost(struct runq *rq)
+{
+    int level;
+
+    for(level = 1; level < NMLFQ; level++){
+        if(rq->head[level] == 0)
+            continue;
+        if(rq->tail[0])
+            rq->tail[0]->rqnext = rq->head[level];
+        else
+            rq->head[0] = rq->head[level];
+        rq->tail[0] = rq->tail[level];
+        rq->head[level] = 0;
+        rq->tail[level] = 0;
+    }
+    rq->epoch = boost_epoch;
+}
+
+/* This function decides which scheduler to use.
+   In this function, I apply Stride algorithm once more.
+   Only a class which has runnable process on this CPU can be selected. */
+int
+decide_scheduler(struct runq *rq)
+{
+    uint mlfq_stride, stride_stride;
+    int stride_ready, mlfq_ready;
+
+    stride_ready = rq->nheap > 0;
+    mlfq_ready = runq_movable(rq) - rq->nheap > 0;
+
+    if(total_tickets){
+    /* In every case total tickets are 100(CPU share 100%).
+       Each Scheduler's stride = STRIDE1 / Scheduler's tickets.
+
+       Stride Scheduler's tickets : Total tickets which used in 
+                                    Stride Scheduler. (Limitation : schedconf.stride_cap)
+
+       MLFQ Scheduler's tickests : 100 - Stride Scheduler's tickets. */
+
+        stride_stride = STRIDE1 / total_tickets;
+        mlfq_stride = STRIDE1 / (100 - total_tickets);
+    }
+
+    /* If there is no process which will be scheduled in Stride Scheduler,
+       (This means total tickets are 0) select MLFQ Scheduler */
+    else{
+        return 0;
+    }
+
+    /* When one class has nothing to run (e.g. all Stride processes sleep on I/O),
+       it lends its share to the other class. Its pass value keeps up with the other's,
+       so it gets its share back as soon as it has work again,
+       but it can't run in a burst to take back what it lent. */
+    if(!stride_ready && rq->stride_pass_value < rq->mlfq_pass_value)
+        rq->stride_pass_value = rq->mlfq_pass_value;
+    if(!mlfq_ready && rq->mlfq_pass_value < rq->stride_pass_value)
+        rq->mlfq_pass_value = rq->stride_pass_value;
+
+    /* Select scheduler whose pass value is less than the other's. */
+
+    if(stride_ready && (!mlfq_ready || rq->stride_pass_value <= rq->mlfq_pass_value)){
+        rq->stride_pass_value += stride_stride;    
+        return 1;
+    }
+    // When Stride Scheduler is selected.
+
+    else{
+        if(mlfq_ready)
+            rq->mlfq_pass_value += mlfq_stride;
+        return 0;
+    }
+    // When MLFQ Scheduler is selected.
+}
+
+/* This function gives each member of the group (the process and its threads)
+   stride = STRIDE1 * (number of members) / process' tickets,
+   so the whole group gets the share which the process reserved.
+   Queued member is taken off its run queue while its class and stride change,
+   then queued again where they put it. */
+static void
+group_restride(struct proc *g)
+{
+    struct runq *rq;
+    struct proc *p;
+    int members, queued, tickets;
+
+    members = g->nthreads + 1;
+
+    for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
+        if(p != g && (p->tid <= 0 || p->parent != g))
+            continue;
+        if(p->state == UNUSED || p->state == ZOMBIE)
+            continue;
+
+        // EDF queues and the gang slot don't depend on the class.
+        rq = 0;
+        queued = 0;
+        if(p->state == RUNNABLE && !p->edf){
+            rq = runq_lock(p);
+            queued = rq->gang != p && runq_remove(rq, p);
+        }
+
+        tickets = p->tickets;
+        p->tickets = g->tickets;
+        p->stride = g->tickets > 0 ? STRIDE1 * members / g->tickets : 0;
+
+        if(queued){
+            if(p->tickets > 0){
+                // Member which joins Stride starts one stride ahead of virtual time.
+                if(tickets == 0)
+                    p->pass_value = rq->stride_vtime + p->stride;
+                stride_push(rq, p);
+            }
+            else
+                mlfq_push(rq, p);
+        }
+        if(rq)
+            release(&rq->lock);
+    }
+}
+
+static void
+tid_insert(struct proc *t)
+{
+    struct proc **pp;
+
+    pp = &tidhash[t->tid % NTIDHASH];
+    t->tidnext = *pp;
+    *pp = t;
+}
+
+static struct proc*
+tid_lookup(int tid)
+{
+    struct proc *t;
+
+    if(tid <= 0)
+        return 0;
+    for(t = tidhash[tid % NTIDHASH]; t && t->tid != tid; t = t->tidnext)
+        ;
+    return t;
+}
+
+static void
+tid_remove(struct proc *t)
+{
+    struct proc **pp;
+
+    for(pp = &tidhash[t->tid % NTIDHASH]; *pp; pp = &(*pp)->tidnext){
+        if(*pp == t){
+            *pp = t->tidnext;
+            break;
+        }
+    }
+    t->tidnext = 0;
+}
+
+static struct sleepq*
+sleepq_of(void *chan)
+{
+    return &sleepqs[((uint)chan >> 2) % NSLEEPQ];
+}
+
+/* This function is for process which leaves sleep without wakeup() (e.g. killed). */
+static void
+sleepq_remove(struct proc *p)
+{
+    struct sleepq *sq;
+    struct proc **pp;
+
+    sq = sleepq_of(p->chan);
+    acquire(&sq->lock);
+    for(pp = &sq->head; *pp; pp = &(*pp)->sqnext){
+        if(*pp == p){
+            *pp = p->sqnext;
+            break;
+        }
+    }
+    p->sqnext = 0;
+    release(&sq->lock);
+}
+
+/* This function puts process on a run queue.
+   Process goes back to the CPU it last ran on, for its cache is still warm there.
+   New one, or one whose affinity excludes that CPU, goes to the least loaded CPU it may run on. */
+static void
+setrunnable(struct proc *p)
+{
+    struct runq *rq;
+    int i, c, ahead;
+
+    if(!holding(&ptable.lock))
+        panic("setrunnable");
+
+    c = p->lastcpu;
+    if(c < 0 || !(p->cpumask & (1 << c))){
+        c = -1;
+        for(i = 0; i < ncpu; i++){
+            if((p->cpumask & (1 << i)) && (c < 0 || runqs[i].nrun < runqs[c].nrun))
+                c = i;
+        }
+        if(c < 0)
+            panic("setrunnable cpumask");
+    }
+    rq = &runqs[c];
+
+    if(p->state == SLEEPING)
+        trace(TR_WAKEUP, p, c);
+    p->state = RUNNABLE;
+    p->rqstamp = nanotime();
+
+    // Thread is queued at its process' MLFQ level.
+    mlfq_catchup(p);
+    if(p->tid > 0){
+        mlfq_catchup(p->parent);
+        p->priority = p->parent->priority;
+    }
+
+    acquire(&rq->lock);
+
+    p->rqcpu = c;
+    if(p->edf){
+        /* EDF task without budget waits for its next job release (see edf_tick). */
+        if(p->edf_budget > 0 && !p->edf_done){
+            edf_push(rq, p);
+            rq->nrun++;
+        }
+        else{
+            p->rqnext = rq->edf_throttled;
+            rq->edf_throttled = p;
+        }
+    }
+    else if(p->tickets > 0){
+        /* Process which has been sleeping (not the yielding one) rejoins
+           at the virtual time of its new CPU, as far ahead as it was when it left. */
+        if(p != proc)
+            p->pass_value = rq->stride_vtime + p->remain;
+        stride_push(rq, p);
+        rq->nrun++;
+    }
+    else{
+        mlfq_push(rq, p);
+        rq->nrun++;
+    }
+    ahead = rq->nrun - 1;
+
+    release(&rq->lock);
+
+    /* Wake up a halted CPU to run it. The target CPU is preferred.
+       When it's busy, an idle CPU is woken to pull it by load balancing only if
+       other work is queued ahead of it there. Process which requeues itself
+       (yield, end of time slice) isn't moved, so it keeps its cache and TLB. */
+    if(!cpus[c].idle){
+        if(p == proc || ahead <= 0)
+            return;
+        for(c = 0; c < ncpu; c++){
+            if(cpus[c].idle)
+                break;
+        }
+    }
+    if(c < ncpu && &cpus[c] != cpu)
+        lapicipi(cpus[c].apicid, T_IRQ0 + IRQ_RESCHED);
+}
+
+/* This function makes p the running process of this CPU, ptable.lock held.
+   Caller switches to its address space and context. */
+static void
+proc_dispatch(struct proc *p, int charge)
+{
+    struct runq *rq;
+    struct proc *g;
+
+    rq = &runqs[cpu - cpus];
+    if(charge && p->tickets > 0){
+        if(p->pass_value > rq->stride_vtime)
+            rq->stride_vtime = p->pass_value;
+        p->pass_value += p->stride;
+        // Manage pass value.
+    }
+
+    g = p->tid > 0 ? p->parent : p;
+    if(charge && g->gang && g->gangslice != ticks){
+        g->gangslice = ticks;
+        gang_launch(g, p);
+    }
+
+    p->wait_ns += nanotime() - p->rqstamp;
+    if(p->lastcpu >= 0 && p->lastcpu != cpu - cpus)
+        p->nmigrate++;
+    p->lastcpu = cpu - cpus;
+    proc = p;
+    p->state = RUNNING;
+    trace(TR_SWITCHIN, p, p->tickets > 0 ? p->tickets : p->priority);
+}
+
+/* This function switches directly to runnable thread tid of the calling process,
+   without going through the scheduler. Thread runs the rest of the caller's time slice,
+   so its pass value isn't charged; caller goes back to its run queue. */
+int
+yield_to(int tid)
+{
+    struct proc *g, *t, *old;
+    struct runq *rq;
+    int intena;
+
+    acquire(&ptable.lock);
+
+    g = proc->tid > 0 ? proc->parent : proc;
+    t = tid_lookup(tid);
+    if(t == 0 || t->parent != g || t == proc || t->state != RUNNABLE || t->edf ||
+       !(t->cpumask & (1 << (cpu - cpus)))){
+        release(&ptable.lock);
+        return -1;
+    }
+
+    // Take it off its run queue.
+    rq = runq_lock(t);
+    if(rq->gang == t)
+        rq->gang = 0;
+    else if(!runq_remove(rq, t)){
+        release(&rq->lock);
+        release(&ptable.lock);
+        return -1;
+    }
+    rq->nrun--;
+    release(&rq->lock);
+
+    old = proc;
+    old->nvcsw++;
+    setrunnable(old);
+    trace(TR_SWITCHOUT, old, old->state);
+
+    if(cpu->ncli != 1)
+        panic("yield_to locks");
+    proc_dispatch(t, 0);
+    switchproc(t, old->pgdir);
+    intena = cpu->intena;
+    swtch(&old->context, t->context);
+    cpu->intena = intena;
+
+    release(&ptable.lock);
+    return 0;
+}
+
+/* This function takes the next process to run on this CPU, ptable.lock held.
+   First it decides which scheduler to use: decide_scheduler() returns 1 for Stride Scheduler,
+   0 for MLFQ Scheduler. The other class runs if the queue changed since then. */
+static struct proc*
+runq_next(struct runq *rq, pde_t *pgdir)
+{
+    struct proc *p;
+    int i;
+
+    for(;;){
+        /* Released EDF jobs run ahead of everything else, earliest deadline first. */
+        if(rq->edfq){
+            acquire(&rq->lock);
+            if((p = rq->edfq) != 0){
+                rq->edfq = p->rqnext;
+                p->rqnext = 0;
+                rq->nedf--;
+                rq->nrun--;
+            }
+            release(&rq->lock);
+            if(p)
+                return p;
+        }
+
+        /* Gang member placed here runs next. Its class and pass are still charged,
+           so the gang gets its siblings together by borrowing from its own share. */
+        if(rq->gang){
+            acquire(&rq->lock);
+            if((p = rq->gang) != 0){
+                rq->gang = 0;
+                rq->nrun--;
+            }
+            release(&rq->lock);
+            if(p){
+                if(total_tickets && p->tickets > 0)
+                    rq->stride_pass_value += STRIDE1 / total_tickets;
+                else if(total_tickets)
+                    rq->mlfq_pass_value += STRIDE1 / (100 - total_tickets);
+                return p;
+            }
+        }
+
+        i = decide_scheduler(rq);
+        if((p = runq_pop(rq, i, pgdir)) == 0)
+            p = runq_pop(rq, !i, pgdir);
+        if(p == 0 || (p->cpumask & (1 << (cpu - cpus))))
+            return p;
+
+        /* Affinity changed while it was queued here: move it to a CPU it may run on. */
+        if(p->tickets > 0)
+            p->remain = p->pass_value > rq->stride_vtime ? p->pass_value - rq->stride_vtime : 0;
+        setrunnable(p);
+    }
+}
+
+/* This function locks the run queue of runnable process p.
+   Load balancing may move p meanwhile, so it checks p->rqcpu under the lock. */
+static struct runq*
+runq_lock(struct proc *p)
+{
+    struct runq *rq;
+
+    for(;;){
+        rq = &runqs[p->rqcpu];
+        acquire(&rq->lock);
+        if(p->rqcpu == rq - runqs)
+            return rq;
+        release(&rq->lock);
+    }
+}
+
+/* This function takes runnable process out of run queue, rq->lock held.
+   It looks where p was pushed, not at its tickets, which may change while it's queued. */
+static int
+runq_remove(struct runq *rq, struct proc *p)
+{
+    struct proc **pp, *last;
+    int i, level, child, parent;
+
+    if(p->rqheap){
+        for(i = 0; i < rq->nheap && rq->heap[i] != p; i++)
+            ;
+        if(i == rq->nheap)
+            return 0;
+        last = rq->heap[--rq->nheap];
+        if(i == rq->nheap)
+            return 1;
+        // Put the last one in its place, then sift it down or up.
+        for(; (child = 2 * i + 1) < rq->nheap; i = child){
+            if(child + 1 < rq->nheap && rq->heap[child + 1]->pass_value < rq->heap[child]->pass_value)
+                child++;
+            if(last->pass_value <= rq->heap[child]->pass_value)
+                break;
+            rq->heap[i] = rq->heap[child];
+        }
+        for(; i > 0; i = parent){
+            parent = (i - 1) / 2;
+            if(rq->heap[parent]->pass_value <= last->pass_value)
+                break;
+            rq->heap[i] = rq->heap[parent];
+        }
+        rq->heap[i] = last;
+        return 1;
+    }
+
+    for(level = 0; level < NMLFQ; level++){
+        last = 0;
+        for(pp = &rq->head[level]; *pp; last = *pp, pp = &(*pp)->rqnext){
+            if(*pp == p){
+                *pp = p->rqnext;
+                if(rq->tail[level] == p)
+                    rq->tail[level] = last;
+                p->rqnext = 0;
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+/* This function dispatches runnable threads of gang g together with p, which this CPU runs now.
+   Each sibling goes to the gang slot of another CPU it may run on, which isn't running the gang,
+   and that CPU is told to preempt its process. ptable.lock held. */
+static void
+gang_launch(struct proc *g, struct proc *p)
+{
+    struct proc *s;
+    struct runq *src, *dst;
+    uint used;
+    int i, t;
+
+    used = 1 << (cpu - cpus);
+    for(s = ptable.proc; s < &ptable.proc[NPROC]; s++){
+        if(s == p || s->state != RUNNABLE || s->edf || (s != g && (s->tid <= 0 || s->parent != g)))
+            continue;
+        src = &runqs[s->rqcpu];
+        if(src->gang == s)
+            continue;
+
+        // Its own CPU first, then any other.
+        for(t = s->rqcpu, i = 0; i < ncpu; t = (t + 1) % ncpu, i++){
+            if((used & (1 << t)) || !(s->cpumask & (1 << t)) || runqs[t].gang)
+                continue;
+            if(cpus[t].proc && cpus[t].proc->pid == g->pid)
+                continue;
+            break;
+        }
+        if(i == ncpu)
+            return;
+        dst = &runqs[t];
+
+        // Load balancing may have moved it meanwhile.
+        acquire(&src->lock);
+        if(s->rqcpu != src - runqs || !runq_remove(src, s)){
+            release(&src->lock);
+            continue;
+        }
+        src->nrun--;
+        release(&src->lock);
+
+        used |= 1 << t;
+        acquire(&dst->lock);
+        if(s->tickets > 0)
+            s->pass_value = dst->stride_vtime + (s->pass_value > src->stride_vtime ? s->pass_value - src->stride_vtime : 0);
+        s->rqcpu = t;
+        dst->gang = s;
+        dst->nrun++;
+        release(&dst->lock);
+
+        if(&cpus[t] != cpu){
+            cpus[t].resched = 1;
+            lapicipi(cpus[t].apicid, T_IRQ0 + IRQ_RESCHED);
+        }
+    }
+}
+
+/* This function turns gang scheduling of the calling process on or off. */
+int
+set_gang(int on)
+{
+    struct proc *g;
+
+    acquire(&ptable.lock);
+    g = proc->tid > 0 ? proc->parent : proc;
+    g->gang = on != 0;
+    release(&ptable.lock);
+    return 0;
+}
+
+/* This function lets a process sharing pgdir go first among equal candidates:
+   Stride process of the same pass value, or MLFQ process right behind the head of the level.
+   Head can be passed over only once, so no one starves. */
+static void
+runq_prefer(struct runq *rq, int stride, pde_t *pgdir)
+{
+    struct proc *h, *s;
+    int i, level;
+
+    if(pgdir == 0)
+        return;
+
+    if(stride){
+        if(rq->nheap == 0 || rq->heap[0]->pgdir == pgdir)
+            return;
+        for(i = 1; i <= 2 && i < rq->nheap; i++){
+            s = rq->heap[i];
+            if(s->pgdir == pgdir && s->pass_value == rq->heap[0]->pass_value){
+                // Keys are equal, so swapping keeps the heap order.
+                rq->heap[i] = rq->heap[0];
+                rq->heap[0] = s;
+                return;
+            }
+        }
+        return;
+    }
+
+    for(level = 0; level < NMLFQ && rq->head[level] == 0; level++)
+        ;
+    if(level == NMLFQ)
+        return;
+    h = rq->head[level];
+    s = h->rqnext;
+    if(h->pgdir == pgdir || h->skipped || s == 0 || s->pgdir != pgdir)
+        return;
+    h->rqnext = s->rqnext;
+    s->rqnext = h;
+    rq->head[level] = s;
+    if(rq->tail[level] == s)
+        rq->tail[level] = h;
+    h->skipped = 1;
+}
+
+/* This function takes the least pass value process (Stride),
+   or the first process of the highest non-empty level (MLFQ). */
+static struct proc*
+runq_pop(struct runq *rq, int stride, pde_t *pgdir)
+{
+    struct proc *p;
+    int level;
+
+    if(rq->nrun == 0)
+        return 0;
+
+    p = 0;
+    acquire(&rq->lock);
+
+    if(rq->epoch != boost_epoch)
+        runq_boost(rq);
+
+    runq_prefer(rq, stride, pgdir);
+
+    if(stride){
+        p = stride_pop(rq);
+    }
+    else{
+        for(level = 0; level < NMLFQ && p == 0; level++)
+            p = mlfq_pop(rq, level);
+    }
+
+    if(p)
+        rq->nrun--;
+
+    release(&rq->lock);
+    return p;
+}
+
+/* This function inserts process into Stride heap, then moves it up
+   while its pass value is less than its parent's. */
+static void
+stride_push(struct runq *rq, struct proc *p)
+{
+    int i, parent;
+
+    p->rqheap = 1;
+    for(i = rq->nheap++; i > 0; i = parent){
+        parent = (i - 1) / 2;
+        if(rq->heap[parent]->pass_value <= p->pass_value)
+            break;
+        rq->heap[i] = rq->heap[parent];
+    }
+    rq->heap[i] = p;
+}
+
+/* This function removes root of Stride heap, then moves the last process
+   down from root while its pass value is greater than its children's. */
+static struct proc*
+stride_pop(struct runq *rq)
+{
+    struct proc *p, *last;
+    int i, child;
+
+    if(rq->nheap == 0)
+        return 0;
+
+    p = rq->heap[0];
+    last = rq->heap[--rq->nheap];
+
+    for(i = 0; (child = 2 * i + 1) < rq->nheap; i = child){
+        if(child + 1 < rq->nheap && rq->heap[child + 1]->pass_value < rq->heap[child]->pass_value)
+            child++;
+        if(last->pass_value <= rq->heap[child]->pass_value)
+            break;
+        rq->heap[i] = rq->heap[child];
+    }
+    rq->heap[i] = last;
+
+    return p;
+}
+
+/* MLFQ queue is FIFO, so each level is served round robin. */
+static void
+mlfq_push(struct runq *rq, struct proc *p)
+{
+    p->rqheap = 0;
+    p->rqnext = 0;
+    if(rq->tail[p->priority])
+        rq->tail[p->priority]->rqnext = p;
+    else
+        rq->head[p->priority] = p;
+    rq->tail[p->priority] = p;
+}
+
+static struct proc*
+mlfq_pop(struct runq *rq, int level)
+{
+    struct proc *p;
+
+    if((p = rq->head[level]) != 0){
+        if((rq->head[level] = p->rqnext) == 0)
+            rq->tail[level] = 0;
+        p->rqnext = 0;
+        p->skipped = 0;
+    }
+    return p;
+}
+
+static int
+runq_movable(struct runq *rq)
+{
+    return rq->nrun - rq->nedf - (rq->gang != 0);
+}
+
+/* This function balances load between this CPU and the busiest one.
+   It pulls half of the difference in one batch, so that a process doesn't
+   bounce between CPUs on every pass. Stride processes are pulled while the busiest
+   CPU has more of them, then MLFQ processes from the lowest level, which are the least
+   latency sensitive. Pulled processes keep their level and pass value. */
+static int
+runq_balance(struct runq *rq)
+{
+    struct runq *busiest;
+    struct proc *p, *skipped;
+    int i, n, moved, tries, level;
+
+    busiest = 0;
+    for(i = 0; i < ncpu; i++){
+        if(&runqs[i] != rq && (busiest == 0 || runq_movable(&runqs[i]) > runq_movable(busiest)))
+            busiest = &runqs[i];
+    }
+    if(busiest == 0 || busiest->nrun <= rq->nrun || runq_movable(busiest) == 0)
+        return 0;
+
+    /* Lock both run queues in CPU order to avoid deadlock. */
+    if(busiest < rq){
+        acquire(&busiest->lock);
+        acquire(&rq->lock);
+    }
+    else{
+        acquire(&rq->lock);
+        acquire(&busiest->lock);
+    }
+
+    rq->nsteal++;
+
+    n = (busiest->nrun - rq->nrun) / 2;
+    if(n == 0 && rq->nrun == 0)
+        n = 1;
+    // Idle CPU takes even the only waiting process.
+
+    skipped = 0;
+    for(moved = 0, tries = busiest->nrun; moved < n && tries > 0; tries--){
+        p = 0;
+        if(busiest->nheap > rq->nheap)
+            p = stride_pop(busiest);
+        for(level = NMLFQ - 1; level >= 0 && p == 0; level--)
+            p = mlfq_pop(busiest, level);
+        if(p == 0 && (p = stride_pop(busiest)) == 0)
+            break;
+
+        // Leave processes which may not run here.
+        if(!(p->cpumask & (1 << (rq - runqs)))){
+            p->rqnext = skipped;
+            skipped = p;
+            continue;
+        }
+
+        if(p->tickets > 0){
+            // Keep its distance to virtual time. It may lag behind, e.g. after a gang dispatch raised it.
+            p->pass_value = rq->stride_vtime + (p->pass_value > busiest->stride_vtime ? p->pass_value - busiest->stride_vtime : 0);
+            stride_push(rq, p);
+        }
+        else{
+            mlfq_catchup(p);
+            mlfq_push(rq, p);
+        }
+        p->rqcpu = rq - runqs;
+        busiest->nrun--;
+        rq->nrun++;
+        moved++;
+    }
+    rq->nmigrate += moved;
+
+    while((p = skipped) != 0){
+        skipped = p->rqnext;
+        if(p->tickets > 0)
+            stride_push(busiest, p);
+        else
+            mlfq_push(busiest, p);
+    }
+
+    release(&busiest->lock);
+    release(&rq->lock);
+
+    return moved;
+}
+
+/* This function is called on every CPU's timer interrupt,
+   and balances load once in BALANCE_PERIOD ticks. */
+void
+load_balance(void)
+{
+    struct runq *rq;
+
+    rq = &runqs[cpu - cpus];
+    if(++rq->balance_ticks < BALANCE_PERIOD)
+        return;
+    rq->balance_ticks = 0;
+
+    runq_balance(rq);
+}
+
+/* This function switches to p's address space, when pgdir is the one loaded on this CPU.
+   Threads of that process skip the %cr3 reload (and TLB flush), unless pages
+   of the process were unmapped since this CPU loaded it (see tstack_free). */
+static void
+switchproc(struct proc *p, pde_t *pgdir)
+{
+    struct proc *g;
+
+    g = p->tid > 0 ? p->parent : p;
+    if(p->pgdir == pgdir && cpu->tlbgen == g->tlbgen){
+        switchtss(p);
+    }
+    else{
+        switchuvm(p);
+        cpu->tlbgen = g->tlbgen;
+    }
+}
+
+/* This function allocates user stack of npages pages for a new thread of process g,
+   with a guard page below it, ptable.lock held. Pages above the program image which
+   aren't mapped are holes left by joined threads; it takes the lowest one which is
+   large enough, or grows the process at its end. Returns base of the stack (guard page), or 0. */
+static uint
+tstack_alloc(struct proc *g, int npages)
+{
+    uint a, base, size, top;
+
+    size = (npages + 1) * PGSIZE;
+    top = PGROUNDUP(g->sz);
+
+    // First fit. When no hole is large enough, base is where the trailing one (or the end) begins.
+    for(base = a = PGROUNDUP(g->std); a < top && a - base < size; a += PGSIZE){
+        if(uvmmapped(g->pgdir, a))
+            base = a + PGSIZE;
+    }
+
+    if(allocuvm(g->pgdir, base, base + size) == 0)
+        return 0;
+    clearpteu(g->pgdir, (char*)base);
+    if(base + size > g->sz)
+        g->sz = base + size;
+
+    return base;
+}
+
+/* This function frees user stack of a joined thread of process g, ptable.lock held.
+   Its pages become a hole for later threads, or the process shrinks if it was at the end.
+   Siblings running on other CPUs reload %cr3 at their next switch (see switchproc). */
+static void
+tstack_free(struct proc *g, uint base, uint size)
+{
+    deallocuvm(g->pgdir, base + size, base);
+    g->tlbgen++;
+    lcr3(V2P(proc->pgdir));
+
+    if(base + size < g->sz)
+        return;
+    g->sz = base;
+    while(g->sz > PGROUNDUP(g->std) && !uvmmapped(g->pgdir, g->sz - PGSIZE))
+        g->sz -= PGSIZE;
+    // Give back the holes which end up at the end too.
+}
+
+/* This function takes stacks which a joined thread of process g left, ptable.lock held.
+   Kernel stack is any cached one. User stack must be size bytes, guard page included;
+   it's still mapped, so it's reused without allocating or zeroing pages.
+   Returns base of the user stack and sets *kstack, each 0 if none is cached (or kstack is 0). */
+static uint
+tcache_get(struct proc *g, uint size, char **kstack)
+{
+    uint base;
+    int i;
+
+    if(kstack){
+        *kstack = 0;
+        if(g->kscache){
+            *kstack = g->kscache;
+            g->kscache = *(char**)g->kscache;
+            g->nkscache--;
+        }
+    }
+
+    base = 0;
+    for(i = g->ntscache - 1; i >= 0; i--){
+        if(g->tscachesz[i] == size){
+            base = g->tscache[i];
+            g->ntscache--;
+            g->tscache[i] = g->tscache[g->ntscache];
+            g->tscachesz[i] = g->tscachesz[g->ntscache];
+            break;
+        }
+    }
+    return base;
+}
+
+/* This function keeps stacks of joined thread t for the next thread of process g,
+   or frees them when g has cached NTCACHE of them already. ptable.lock held. */
+static void
+tcache_put(struct proc *g, struct proc *t)
+{
+    if(g->nkscache < NTCACHE){
+        *(char**)t->kstack = g->kscache;
+        g->kscache = t->kstack;
+        g->nkscache++;
+    }
+    else{
+        kfree(t->kstack);
+    }
+
+    if(g->ntscache < NTCACHE){
+        g->tscache[g->ntscache] = t->tstack;
+        g->tscachesz[g->ntscache] = t->tstacksz;
+        g->ntscache++;
+    }
+    else{
+        tstack_free(g, t->tstack, t->tstacksz);
+    }
+}
+
+/* This function drops cached user stacks which process g no longer has all of,
+   after it shrank to sz. ptable.lock held. */
+static void
+tcache_trim(struct proc *g, uint sz)
+{
+    int i;
+
+    for(i = g->ntscache - 1; i >= 0; i--){
+        if(g->tscache[i] + g->tscachesz[i] > sz){
+            deallocuvm(g->pgdir, g->tscache[i] + g->tscachesz[i], g->tscache[i]);
+            g->ntscache--;
+            g->tscache[i] = g->tscache[g->ntscache];
+            g->tscachesz[i] = g->tscachesz[g->ntscache];
+        }
+    }
+}
+
+/* This function finds where process g may shrink to without unmapping a stack
+   which one of its threads still owns. Cached stacks may go; see tcache_trim(). */
+static uint
+tstack_end(struct proc *g)
+{
+    struct proc *p;
+    uint end;
+
+    end = 0;
+    for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
+        if(p->parent == g && p->state != UNUSED && p->tstack && p->tstack + p->tstacksz > end)
+            end = p->tstack + p->tstacksz;
+    }
+    return end;
+}
+
+/* This function frees kernel stacks cached by process g. User stacks are freed with its pgdir. */
+static void
+tcache_flush(struct proc *g)
+{
+    char *k;
+
+    while((k = g->kscache) != 0){
+        g->kscache = *(char**)k;
+        kfree(k);
+    }
+    g->nkscache = 0;
+    g->ntscache = 0;
+}
+
+/* Thread Function */
+
+/* This function creates thread with given argument(arg).
+ * Then saves its thread id in given argument(thread).
+ * @param[out]    thread           ID of new thread
+ * @param[in]     start_routine    Thread function to execute(main function of new thread)
+ * @param[in]     arg              argument pass to start_routine
+ * return                          If souccess 0, else -1
+ */
+int
+thread_create(thread_t *thread, void *(*start_routine)(void *), void *arg, int stacksize)
+{
+    int i, npages;
+
+    struct proc *nt, *tparent;
+    uint sp, base, ustack[2];
+    char *kstack;
+
+    // Stack size is rounded up to pages, a guard page is added below.
+    if(stacksize < 0 || stacksize > TSTACKMAX * PGSIZE)
+        return -1;
+    npages = stacksize ? PGROUNDUP(stacksize) / PGSIZE : TSTACKPAGES;
+
+    // When thread calls thread_create. Including nested case.
+    tparent = proc;
+    while(tparent->tid > 0){
+        tparent = tparent->parent;
+    }
+
+    /* Stacks of a joined thread are reused if the process cached them. */
+    acquire(&ptable.lock);
+    tcache_get(tparent, 0, &kstack);
+    release(&ptable.lock);
+
+    /* kernel stack */
+
+    // Allocate thread
+    if((nt = allocproc(kstack)) == 0){
+        if(kstack)
+            kfree(kstack);
+        return -1;
+    }
+
+    nt->parent = tparent;
 
     // Reallocate pid
     nt->pid = tparent->pid;
@@ -898,6 +2511,26 @@ thread_create(thread_t *thread, void *(*start_routine)(void *), void *arg)
     // Initialize standard.    
     nt->std = tparent->std;
 
+    /* User stack. It's owned by nt as soon as it's taken, so growproc() sees it. */
+    acquire(&ptable.lock);
+    base = tcache_get(tparent, (npages + 1) * PGSIZE, 0);
+    if(base == 0)
+        base = tstack_alloc(tparent, npages);
+    nt->tstack = base;
+    nt->tstacksz = (npages + 1) * PGSIZE;
+    release(&ptable.lock);
+    if(base == 0){
+        kfree(nt->kstack);
+        nt->kstack = 0;
+        nt->pid = 0;
+        nt->parent = 0;
+        nt->state = UNUSED;
+        return -1;
+    }
+
+    // In thread, sz means each thread's top stack loaction. In process, sz means size of whole process memory.
+    sp = nt->sz = base + nt->tstacksz;
+
     for(i = 0; i < NOFILE; i++){
         if(proc->ofile[i]){
             nt->ofile[i] = filedup(proc->ofile[i]);
@@ -906,31 +2539,8 @@ thread_create(thread_t *thread, void *(*start_routine)(void *), void *arg)
     nt->cwd = idup(proc->cwd);
 
     safestrcpy(nt->name, tparent->name, sizeof(tparent->name));
-
-    /* User stack */
-
-    // Find empty space
-    for(i = 0; i < 10; i++){
-        if(tparent->tspace[i] == 0){
-            tparent->tspace[i] = 1;
-            nt->tspace[i] = 1;
-            espace = i;
-            break;
-        }
-    }
-    // When there are no empty spaces : error
-    if(espace < 0){
-        return -1;
-    }
-
-    if((sp = allocuvm(nt->pgdir, tparent->std  + (2 * PGSIZE) * (espace), tparent->std  + (2 * PGSIZE) * (espace) + 2 * PGSIZE))==0){   
-        return -1;
-    }
-    clearpteu(nt->pgdir, (char*)(tparent->std  + (2 * PGSIZE) * (espace)));
-
-    // Reallocate sz : In thread, sz means each thread's top stack loaction. In process, sz means size of whole process memory.
-    nt->sz = sp;
-    nt->parent->sz = nt->parent->std + 10 * (2*PGSIZE);
+    nt->cpumask = proc->edf ? ~0 : proc->cpumask;
+    // Like a fork child, a thread of an EDF task isn't one, so it isn't pinned to its CPU.
 
     ustack[0] = 0xffffffff;  // fake return PC
     ustack[1] = (uint)arg;
@@ -946,14 +2556,20 @@ thread_create(thread_t *thread, void *(*start_routine)(void *), void *arg)
     // Save new sp in esp
     nt->tf->esp = sp;
   
-    // Save thread ID in given argument
-    *thread = nt->tid;
-
-    // Change new thread's state
+    // Change new thread's state.
+    // New thread shares the process' CPU share with other threads.
     acquire(&ptable.lock);
-    nt->state = RUNNABLE;
+    nt->tid = nexttid++;
+    tid_insert(nt);
+    tparent->nthreads++;
+    trace(TR_TCREATE, nt, tparent->pid);
+    group_restride(tparent);
+    setrunnable(nt);
     release(&ptable.lock);
 
+    // Save thread ID in given argument
+    *thread = nt->tid;
+
     return 0;
 }
 
@@ -974,12 +2590,18 @@ thread_exit(void *retval)
 
     acquire(&ptable.lock);
 
-    // Parent might be sleeping in wait().
-    wakeup1(proc->parent);
+    // Joiner might be sleeping in thread_join().
+    wakeup1(&proc->ret_val);
 
     // Change thread's state. 
     // Jump into the scheduler, never to return.
     proc->state = ZOMBIE;
+    edf_leave(proc);
+
+    // Remaining threads share the process' CPU share.
+    proc->parent->nthreads--;
+    group_restride(proc->parent);
+    trace(TR_TEXIT, proc, proc->parent->pid);
 
     sched();
     panic("zombie exit");
@@ -994,63 +2616,50 @@ int
 thread_join(thread_t thread, void **retval)
 {
     struct proc *p;
-    int havethread,i;
 
     acquire(&ptable.lock);
     for(;;){
-        // Scan through table looking for exited children.
-        havethread = 0;
-        for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-            if(p->tid != thread)
-                continue;
-            havethread = 1;
-            if(p->state == ZOMBIE){
-                // Found one.
-                /* Reset attributes. */
-
-                // Deallocate kernel stack.
-                kfree(p->kstack);
-                p->kstack = 0;
-
-                p->pid = 0;
-                p->tid = 0;
-
-                // Store thread's return value.
-                *retval = p->ret_val;
-                p->ret_val = 0;
-                
-                for(i = 0; i < 10; i++){
-                    if(p->tspace[i] == 1){
-                        p->tspace[i] = 0;
-
-                        // Remove parent's tspace also.
-                        p->parent->tspace[i] = 0;
-
-                        break;
-                    }
-                }
+        // Look the thread up again after each sleep; another joiner may have taken it.
+        // Only threads of the caller's process can be joined.
+        p = tid_lookup(thread);
+        if(p == 0 || p->pid != proc->pid || p == proc){
+            release(&ptable.lock);
+            return -1;
+        }
 
-                // Deallocate user stack.
-                deallocuvm(p->pgdir, p->sz, p->sz - 2*PGSIZE);
+        if(p->state == ZOMBIE){
+            // Found one.
+            /* Reset attributes. */
+            tid_remove(p);
 
-                p->sz = 0;
-                p->parent = 0;
-                p->name[0] = 0;
-                p->killed = 0;
-                p->state = UNUSED;
-                release(&ptable.lock);
+            // Keep stacks for the next thread, or deallocate them.
+            tcache_put(p->parent, p);
+            p->kstack = 0;
 
-                return 0;
-            }
+            p->pid = 0;
+            p->tid = 0;
+
+            // Store thread's return value.
+            *retval = p->ret_val;
+            p->ret_val = 0;
+
+            p->sz = 0;
+            p->parent = 0;
+            p->name[0] = 0;
+            p->killed = 0;
+            p->state = UNUSED;
+            release(&ptable.lock);
+
+            return 0;
         }
 
-        // No point waiting if it's not the chosen thread.
-        if(!havethread || proc->killed){
+        if(proc->killed){
             release(&ptable.lock);
             return -1;
         }
 
-        // Wait for the chosen thread to exit.  (See wakeup1 call in proc_exit.)
-        sleep(proc, &ptable.lock);  //DOC: wait-sleep
+        // Wait for the chosen thread to exit. Its exit wakes only its own joiners.
+        // (See wakeup1 calls in thread_exit and exit.)
+        sleep(&p->ret_val, &ptable.lock);  //DOC: wait-sleep
     }
 }
@@ -7,6 +7,11 @@ struct cpu {
   volatile uint started;       // Has the CPU started?
   int ncli;                    // Depth of pushcli nesting.
   int intena;                  // Were interrupts enabled before pushcli?
+  volatile uint idle;          // Is the CPU halted in scheduler()?
+  volatile uint resched;       // Should the running process yield to a gang member?
+  uint busyticks;              // Timer ticks spent running a process
+  uint idleticks;              // Timer ticks spent without a process
+  uint tlbgen;                 // Loaded process' tlbgen when %cr3 was last loaded
 
   // Cpu-local storage variables; see below
   struct cpu *cpu;
@@ -57,21 +62,58 @@ struct proc {
   enum procstate state;        // Process state
   int pid;                     // Process ID
   int tid;                     // Thread ID
-  int tspace[10];              // Thread space
+  uint tstack;                 // Base of thread's user stack, guard page first
+  uint tstacksz;               // Size of thread's user stack, guard page included
+  uint tlbgen;                 // Bumped when process' pages are unmapped (see switchproc)
+  char *kscache;               // Kernel stacks of joined threads, linked through their first word
+  int nkscache;                // Number of them
+  uint tscache[NTCACHE];       // User stacks of joined threads, still mapped
+  uint tscachesz[NTCACHE];     // Their sizes, guard page included
+  int ntscache;                // Number of them
   struct proc *parent;         // Parent process
   struct trapframe *tf;        // Trap frame for current syscall
   struct context *context;     // swtch() here to run process
   void *chan;                  // If non-zero, sleeping on chan
+  struct proc *sqnext;         // Next process in the same sleep queue
   int killed;                  // If non-zero, have been killed
   struct file *ofile[NOFILE];  // Open files
   struct inode *cwd;           // Current directory
   char name[16];               // Process name (debugging)
   int priority;                // Process priority for MLFQ scheduling
   int ticks;                   // Time slice which process uses at certain priority level
+  uint epoch;                  // Priority boost epoch which priority and ticks belong to
   int tickets;                 // Tickets which process uses in stride scheduling
-  int stride;                  // process' stride = total_tickets / process' tickets
-  int pass_value;              // process' pass value += process' stride
-  void *ret_val;               // Return value of thread
+  int stride;                  // process' stride = STRIDE1 / process' tickets
+  uint64 pass_value;           // process' pass value += process' stride
+  int remain;                  // Pass value ahead of virtual time when it went to sleep
+  int nthreads;                // Number of live threads which share process' CPU share
+  void *ret_val;               // Return value of thread (joiners sleep on its address)
+  struct proc *tidnext;        // Next thread in its tid hash chain
+  struct proc *rqnext;         // Next process in the same run queue
+  int rqcpu;                   // CPU whose run queue holds it while RUNNABLE
+  int rqheap;                  // Is it queued in the Stride heap (not an MLFQ queue)?
+  int gang;                    // Are threads of this process gang scheduled?
+  uint gangslice;              // Tick its gang was last dispatched together
+  int skipped;                 // Passed over for a thread sharing pgdir (see runq_prefer)
+  int lastcpu;                 // CPU this process last ran on (-1 if never)
+  uint cpumask;                // CPUs it may run on, bit i for CPU i
+  uint nmigrate;               // Times it ran on a different CPU than last time
+  int edf;                     // Is it an EDF real-time task?
+  int edf_cpu;                 // CPU it's admitted to
+  struct proc *edfnext;        // Next EDF task admitted to the same CPU
+  int edf_runtime;             // Ticks it may run each period
+  int edf_period;              // Ticks between job releases
+  int edf_deadline;            // Ticks from job release to its deadline
+  uint edf_release;            // Tick its current job was released
+  int edf_budget;              // Ticks left for current job
+  int edf_done;                // Has current job finished (or missed its deadline)?
+  uint edf_nmiss;              // Jobs which missed their deadline
+  uint rticks[NMLFQ];          // Ticks run at each MLFQ level
+  uint sticks;                 // Ticks run under stride scheduling
+  uint nvcsw;                  // Voluntary context switches
+  uint nivcsw;                 // Involuntary context switches
+  uint64 rqstamp;              // nanotime() when it was put on a run queue
+  uint64 wait_ns;              // Time spent runnable on a run queue
 };
 
 // Process memory is laid out contiguously, low addresses first:
@@ -0,0 +1,84 @@
+// Port of pthread/3.condition_variable/condition_variable.c.
+// sleep(1) second becomes sleep(100) ticks.
+
+#include "types.h"
+#include "user.h"
+#include "pthread.h"
+
+#define NUM_THREADS  3
+#define TCOUNT 10
+#define COUNT_LIMIT 12
+
+int count = 0;
+pthread_mutex_t count_mutex;
+pthread_cond_t count_threshold_cv;
+
+void*
+inc_count(void *t)
+{
+  int i, my_id;
+
+  my_id = (int)t;
+  for(i = 0; i < TCOUNT; i++){
+    pthread_mutex_lock(&count_mutex);
+    count++;
+
+    if(count == COUNT_LIMIT){
+      printf(1, "inc_count(): thread %d, count = %d  Threshold reached. ",
+             my_id, count);
+      pthread_cond_signal(&count_threshold_cv);
+      printf(1, "Just sent signal.\n");
+    }
+    printf(1, "inc_count(): thread %d, count = %d, unlocking mutex\n",
+           my_id, count);
+    pthread_mutex_unlock(&count_mutex);
+
+    sleep(100);
+  }
+
+  pthread_exit(0);
+}
+
+void*
+watch_count(void *t)
+{
+  int my_id;
+
+  my_id = (int)t;
+  printf(1, "Starting watch_count(): thread %d\n", my_id);
+
+  pthread_mutex_lock(&count_mutex);
+  while(count < COUNT_LIMIT){
+    printf(1, "watch_count(): thread %d Count= %d. Going into wait...\n", my_id, count);
+    pthread_cond_wait(&count_threshold_cv, &count_mutex);
+    printf(1, "watch_count(): thread %d Condition signal received. Count= %d\n", my_id, count);
+  }
+  printf(1, "watch_count(): thread %d Updating the value of count...\n", my_id);
+  count += 125;
+  printf(1, "watch_count(): thread %d count now = %d.\n", my_id, count);
+  printf(1, "watch_count(): thread %d Unlocking mutex.\n", my_id);
+  pthread_mutex_unlock(&count_mutex);
+  pthread_exit(0);
+}
+
+int
+main(int argc, char *argv[])
+{
+  pthread_t threads[NUM_THREADS];
+  int i;
+
+  pthread_mutex_init(&count_mutex, 0);
+  pthread_cond_init(&count_threshold_cv, 0);
+
+  pthread_create(&threads[0], 0, watch_count, (void*)1);
+  pthread_create(&threads[1], 0, inc_count, (void*)2);
+  pthread_create(&threads[2], 0, inc_count, (void*)3);
+
+  // Wait for all threads to complete
+  for(i = 0; i < NUM_THREADS; i++)
+    pthread_join(threads[i], 0);
+  printf(1, "Main(): Waited and joined with %d threads. Final value of count = %d. Done.\n",
+         NUM_THREADS, count);
+
+  pthread_exit(0);
+}
@@ -0,0 +1,45 @@
+// Port of pthread/1.thread_management/create_and_exit.c.
+// The main thread is the process, so it joins its threads
+// instead of leaving them with pthread_exit().
+
+#include "types.h"
+#include "user.h"
+#include "date.h"
+#include "pthread.h"
+
+#define NUM_THREADS    5
+
+void*
+PrintHello(void *threadid)
+{
+  int tid;
+
+  tid = (int)threadid;
+  printf(1, "Hello World! It's me, thread #%d!\n", tid);
+  pthread_exit(0);
+}
+
+int
+main(int argc, char *argv[])
+{
+  pthread_t threads[NUM_THREADS];
+  struct timespec t0, t1;
+  int rc, t;
+
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  for(t = 0; t < NUM_THREADS; t++){
+    rc = pthread_create(&threads[t], 0, PrintHello, (void*)t);
+    printf(1, "In main: creating thread %d thread id: %d\n", t, threads[t]);
+    if(rc){
+      printf(1, "ERROR; return code from pthread_create() is %d\n", rc);
+      exit();
+    }
+  }
+  for(t = 0; t < NUM_THREADS; t++)
+    pthread_join(threads[t], 0);
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+
+  printf(1, "%d threads created and joined in %d us\n", NUM_THREADS,
+         timespec_diff(&t0, &t1, 1000));
+  pthread_exit(0);
+}
@@ -0,0 +1,57 @@
+// Port of pthread/1.thread_management/join.c.
+// xv6 printf has no floating point, so the work sums integers.
+
+#include "types.h"
+#include "user.h"
+#include "date.h"
+#include "pthread.h"
+
+#define NUM_THREADS    4
+
+void*
+BusyWork(void *t)
+{
+  int i, tid;
+  uint result;
+
+  tid = (int)t;
+  result = 0;
+  printf(1, "Thread %d starting...\n", tid);
+  for(i = 0; i < 1000000; i++)
+    result += i;
+  printf(1, "Thread %d done. Result = %d\n", tid, result);
+  pthread_exit(t);
+}
+
+int
+main(int argc, char *argv[])
+{
+  pthread_t thread[NUM_THREADS];
+  struct timespec t0, t1;
+  void *status;
+  int rc, t;
+
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  for(t = 0; t < NUM_THREADS; t++){
+    printf(1, "Main: creating thread %d\n", t);
+    rc = pthread_create(&thread[t], 0, BusyWork, (void*)t);
+    if(rc){
+      printf(1, "ERROR; return code from pthread_create() is %d\n", rc);
+      exit();
+    }
+  }
+
+  for(t = 0; t < NUM_THREADS; t++){
+    rc = pthread_join(thread[t], &status);
+    if(rc){
+      printf(1, "ERROR; return code from pthread_join() is %d\n", rc);
+      exit();
+    }
+    printf(1, "Main: completed join with thread %d having a status of %d\n", t, (int)status);
+  }
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+
+  printf(1, "Main: program completed in %d ms. Exiting.\n",
+         timespec_diff(&t0, &t1, 1000000));
+  pthread_exit(0);
+}
@@ -0,0 +1,49 @@
+// Port of pthread/2.mutex_variable/no_race.c, which increments
+// the global count without a lock, so updates get lost.
+
+#include "types.h"
+#include "user.h"
+#include "date.h"
+#include "pthread.h"
+
+#define NUM_THREAD      8
+#define NUM_INCREASE    1000000
+
+volatile int cnt_global = 0;
+
+void*
+ThreadFunc(void *arg)
+{
+  int i, cnt_local;
+
+  cnt_local = 0;
+  for(i = 0; i < NUM_INCREASE; i++){
+    cnt_local++;
+    cnt_global++;
+  }
+
+  return (void*)cnt_local;
+}
+
+int
+main(int argc, char *argv[])
+{
+  pthread_t threads[NUM_THREAD];
+  struct timespec t0, t1;
+  void *ret;
+  int i;
+
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  for(i = 0; i < NUM_THREAD; i++)
+    pthread_create(&threads[i], 0, ThreadFunc, (void*)i);
+
+  for(i = 0; i < NUM_THREAD; i++){
+    pthread_join(threads[i], &ret);
+    printf(1, "thread %d, local count: %d\n", threads[i], (int)ret);
+  }
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+
+  printf(1, "global count: %d (expected %d), %d ms\n", cnt_global, NUM_THREAD * NUM_INCREASE,
+         timespec_diff(&t0, &t1, 1000000));
+  exit();
+}
@@ -0,0 +1,97 @@
+// Barrier and rwlock benchmark for the pthread library.
+// Threads pass NROUND barriers, checking that nobody runs ahead,
+// then share a table under a rwlock, mostly reading.
+
+#include "types.h"
+#include "user.h"
+#include "date.h"
+#include "pthread.h"
+
+#define NUM_THREAD  8
+#define NROUND      1000
+#define NRW         20000
+#define NTABLE      16
+
+pthread_barrier_t barrier;
+pthread_rwlock_t rwlock = PTHREAD_RWLOCK_INITIALIZER;
+volatile int round[NUM_THREAD];
+int table[NTABLE];
+int bad;
+
+void*
+barriermain(void *arg)
+{
+  int id, i, j;
+
+  id = (int)arg;
+  for(i = 0; i < NROUND; i++){
+    round[id] = i;
+    pthread_barrier_wait(&barrier);
+    for(j = 0; j < NUM_THREAD; j++)
+      if(round[j] < i)
+        bad = 1;
+    pthread_barrier_wait(&barrier);
+  }
+  pthread_exit(0);
+}
+
+void*
+rwmain(void *arg)
+{
+  int id, i, j, sum;
+
+  id = (int)arg;
+  for(i = 0; i < NRW; i++){
+    if(i % 16 == id){
+      // Writer keeps every entry equal.
+      pthread_rwlock_wrlock(&rwlock);
+      for(j = 0; j < NTABLE; j++)
+        table[j]++;
+      pthread_rwlock_unlock(&rwlock);
+    } else {
+      pthread_rwlock_rdlock(&rwlock);
+      for(sum = 0, j = 0; j < NTABLE; j++)
+        sum += table[j];
+      if(sum != table[0] * NTABLE)
+        bad = 1;
+      pthread_rwlock_unlock(&rwlock);
+    }
+  }
+  pthread_exit(0);
+}
+
+int
+run(void *(*fn)(void*))
+{
+  pthread_t threads[NUM_THREAD];
+  struct timespec t0, t1;
+  int i;
+
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  for(i = 0; i < NUM_THREAD; i++){
+    if(pthread_create(&threads[i], 0, fn, (void*)i)){
+      printf(1, "pthread_create failed\n");
+      exit();
+    }
+  }
+  for(i = 0; i < NUM_THREAD; i++)
+    pthread_join(threads[i], 0);
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  return timespec_diff(&t0, &t1, 1000000);
+}
+
+int
+main(int argc, char *argv[])
+{
+  int t;
+
+  pthread_barrier_init(&barrier, 0, NUM_THREAD);
+  t = run(barriermain);
+  printf(1, "barrier: %d rounds of %d threads, %d ms%s\n",
+         2 * NROUND, NUM_THREAD, t, bad ? ", FAILED" : "");
+
+  t = run(rwmain);
+  printf(1, "rwlock: %d ops by %d threads, %d writes each, %d ms%s\n",
+         NRW, NUM_THREAD, NRW / 16, t, bad ? ", FAILED" : "");
+  exit();
+}
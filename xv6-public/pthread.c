@@ -0,0 +1,299 @@
+#include "types.h"
+#include "user.h"
+#include "pthread.h"
+
+#define NSPIN    100          // tries before sleeping on a contended mutex
+#define WAKEALL  0x7fffffff
+#define NSTART   64           // threads created but not started yet
+
+// pthread_create() leaves start routine and argument of a new thread
+// in a free slot, which the thread takes back in pthread_start().
+static struct {
+  void *(*volatile start_routine)(void*);
+  void *arg;
+} starts[NSTART];
+
+int
+pthread_attr_init(pthread_attr_t *attr)
+{
+  attr->stacksize = 0;
+  return 0;
+}
+
+int
+pthread_attr_destroy(pthread_attr_t *attr)
+{
+  return 0;
+}
+
+int
+pthread_attr_setstacksize(pthread_attr_t *attr, uint stacksize)
+{
+  attr->stacksize = stacksize;
+  return 0;
+}
+
+int
+pthread_attr_getstacksize(const pthread_attr_t *attr, uint *stacksize)
+{
+  *stacksize = attr->stacksize;
+  return 0;
+}
+
+// Threads start here, so that returning from the start routine
+// ends the thread as pthread_exit() does.
+static void*
+pthread_start(void *slot)
+{
+  void *(*start_routine)(void*);
+  void *arg;
+  int i;
+
+  i = (int)slot;
+  start_routine = starts[i].start_routine;
+  arg = starts[i].arg;
+  __sync_synchronize();
+  starts[i].start_routine = 0;
+  pthread_exit(start_routine(arg));
+}
+
+int
+pthread_create(pthread_t *thread, const pthread_attr_t *attr,
+               void *(*start_routine)(void*), void *arg)
+{
+  int i;
+
+  for(i = 0; i < NSTART; i++){
+    if(__sync_bool_compare_and_swap(&starts[i].start_routine, 0, start_routine))
+      break;
+  }
+  if(i == NSTART)
+    return EAGAIN;
+  starts[i].arg = arg;
+
+  if(thread_create_stack(thread, pthread_start, (void*)i, attr ? attr->stacksize : 0) < 0){
+    starts[i].start_routine = 0;
+    return EAGAIN;
+  }
+  return 0;
+}
+
+int
+pthread_join(pthread_t thread, void **retval)
+{
+  void *ret;
+
+  if(thread_join(thread, &ret) < 0)
+    return ESRCH;
+  if(retval)
+    *retval = ret;
+  return 0;
+}
+
+// The main thread is the process itself, so it exits the process
+// (and its threads); join them first.
+void
+pthread_exit(void *retval)
+{
+  if(gettid() > 0)
+    thread_exit(retval);
+  exit();
+}
+
+pthread_t
+pthread_self(void)
+{
+  return gettid();
+}
+
+int
+pthread_mutex_init(pthread_mutex_t *m, const pthread_mutexattr_t *attr)
+{
+  m->val = 0;
+  return 0;
+}
+
+int
+pthread_mutex_destroy(pthread_mutex_t *m)
+{
+  return m->val ? EBUSY : 0;
+}
+
+int
+pthread_mutex_lock(pthread_mutex_t *m)
+{
+  uint c;
+  int i;
+
+  // Spin a little, the holder may be about to release it.
+  for(i = 0; i < NSPIN; i++){
+    if((c = __sync_val_compare_and_swap(&m->val, 0, 1)) == 0)
+      return 0;
+    if(c == 2)
+      break;
+  }
+
+  // Mark it contended, so that the holder wakes us.
+  while((c = __sync_lock_test_and_set(&m->val, 2)) != 0)
+    futex_wait(&m->val, 2);
+  return 0;
+}
+
+int
+pthread_mutex_trylock(pthread_mutex_t *m)
+{
+  return __sync_val_compare_and_swap(&m->val, 0, 1) == 0 ? 0 : EBUSY;
+}
+
+int
+pthread_mutex_unlock(pthread_mutex_t *m)
+{
+  if(__sync_fetch_and_sub(&m->val, 1) != 1){
+    m->val = 0;
+    futex_wake(&m->val, 1);
+  }
+  return 0;
+}
+
+int
+pthread_cond_init(pthread_cond_t *c, const pthread_condattr_t *attr)
+{
+  c->seq = 0;
+  return 0;
+}
+
+int
+pthread_cond_destroy(pthread_cond_t *c)
+{
+  return 0;
+}
+
+// A signal between unlocking m and futex_wait() changes seq,
+// so futex_wait() returns at once instead of missing it.
+int
+pthread_cond_wait(pthread_cond_t *c, pthread_mutex_t *m)
+{
+  uint seq;
+
+  seq = c->seq;
+  pthread_mutex_unlock(m);
+  futex_wait(&c->seq, seq);
+  pthread_mutex_lock(m);
+  return 0;
+}
+
+int
+pthread_cond_signal(pthread_cond_t *c)
+{
+  __sync_fetch_and_add(&c->seq, 1);
+  futex_wake(&c->seq, 1);
+  return 0;
+}
+
+int
+pthread_cond_broadcast(pthread_cond_t *c)
+{
+  __sync_fetch_and_add(&c->seq, 1);
+  futex_wake(&c->seq, WAKEALL);
+  return 0;
+}
+
+int
+pthread_barrier_init(pthread_barrier_t *b, const pthread_barrierattr_t *attr, uint n)
+{
+  if(n == 0)
+    return EINVAL;
+  pthread_mutex_init(&b->lock, 0);
+  b->count = 0;
+  b->n = n;
+  b->phase = 0;
+  return 0;
+}
+
+int
+pthread_barrier_destroy(pthread_barrier_t *b)
+{
+  return b->count ? EBUSY : 0;
+}
+
+// The last thread to arrive starts the next phase and wakes the others.
+int
+pthread_barrier_wait(pthread_barrier_t *b)
+{
+  uint phase;
+
+  pthread_mutex_lock(&b->lock);
+  phase = b->phase;
+  if(++b->count == b->n){
+    b->count = 0;
+    b->phase++;
+    futex_wake(&b->phase, WAKEALL);
+    pthread_mutex_unlock(&b->lock);
+    return PTHREAD_BARRIER_SERIAL_THREAD;
+  }
+  pthread_mutex_unlock(&b->lock);
+
+  while(b->phase == phase)
+    futex_wait(&b->phase, phase);
+  return 0;
+}
+
+int
+pthread_rwlock_init(pthread_rwlock_t *rw, const pthread_rwlockattr_t *attr)
+{
+  pthread_mutex_init(&rw->lock, 0);
+  rw->readers = 0;
+  rw->writer = 0;
+  rw->wwait = 0;
+  pthread_cond_init(&rw->read, 0);
+  pthread_cond_init(&rw->write, 0);
+  return 0;
+}
+
+int
+pthread_rwlock_destroy(pthread_rwlock_t *rw)
+{
+  return rw->readers || rw->writer ? EBUSY : 0;
+}
+
+int
+pthread_rwlock_rdlock(pthread_rwlock_t *rw)
+{
+  pthread_mutex_lock(&rw->lock);
+  while(rw->writer || rw->wwait)
+    pthread_cond_wait(&rw->read, &rw->lock);
+  rw->readers++;
+  pthread_mutex_unlock(&rw->lock);
+  return 0;
+}
+
+int
+pthread_rwlock_wrlock(pthread_rwlock_t *rw)
+{
+  pthread_mutex_lock(&rw->lock);
+  rw->wwait++;
+  while(rw->writer || rw->readers)
+    pthread_cond_wait(&rw->write, &rw->lock);
+  rw->wwait--;
+  rw->writer = 1;
+  pthread_mutex_unlock(&rw->lock);
+  return 0;
+}
+
+int
+pthread_rwlock_unlock(pthread_rwlock_t *rw)
+{
+  pthread_mutex_lock(&rw->lock);
+  if(rw->writer)
+    rw->writer = 0;
+  else
+    rw->readers--;
+  if(rw->wwait){
+    if(rw->readers == 0)
+      pthread_cond_signal(&rw->write);
+  }
+  else
+    pthread_cond_broadcast(&rw->read);
+  pthread_mutex_unlock(&rw->lock);
+  return 0;
+}
@@ -0,0 +1,83 @@
+// POSIX-style threads on top of thread_create, thread_join and futexes.
+// Locks take an atomic fast path in user space, and sleep in the
+// kernel with futex_wait() only when contended.
+
+#define EAGAIN  11
+#define EBUSY   16
+#define EINVAL  22
+#define ESRCH   3
+
+#define PTHREAD_BARRIER_SERIAL_THREAD -1
+
+typedef thread_t pthread_t;
+
+typedef struct {
+  uint stacksize;              // Thread stack size in bytes, 0 for the default
+} pthread_attr_t;
+
+typedef struct {
+  int unused;
+} pthread_mutexattr_t, pthread_condattr_t,
+  pthread_barrierattr_t, pthread_rwlockattr_t;
+
+// 0: unlocked, 1: locked, 2: locked and maybe contended
+typedef struct {
+  volatile uint val;
+} pthread_mutex_t;
+
+// Waiters sleep until seq changes.
+typedef struct {
+  volatile uint seq;
+} pthread_cond_t;
+
+typedef struct {
+  pthread_mutex_t lock;
+  uint count;                  // Threads arrived in this phase
+  uint n;                      // Threads to wait for
+  volatile uint phase;         // Bumped when the last one arrives
+} pthread_barrier_t;
+
+// Writers are preferred: readers wait while a writer waits.
+typedef struct {
+  pthread_mutex_t lock;
+  int readers;                 // Readers holding it
+  int writer;                  // Is a writer holding it?
+  int wwait;                   // Writers waiting for it
+  pthread_cond_t read;
+  pthread_cond_t write;
+} pthread_rwlock_t;
+
+#define PTHREAD_MUTEX_INITIALIZER  {0}
+#define PTHREAD_COND_INITIALIZER   {0}
+#define PTHREAD_RWLOCK_INITIALIZER {{0}, 0, 0, 0, {0}, {0}}
+
+int pthread_attr_init(pthread_attr_t*);
+int pthread_attr_destroy(pthread_attr_t*);
+int pthread_attr_setstacksize(pthread_attr_t*, uint);
+int pthread_attr_getstacksize(const pthread_attr_t*, uint*);
+int pthread_create(pthread_t*, const pthread_attr_t*, void *(*)(void*), void*);
+int pthread_join(pthread_t, void**);
+void pthread_exit(void*) __attribute__((noreturn));
+pthread_t pthread_self(void);
+
+int pthread_mutex_init(pthread_mutex_t*, const pthread_mutexattr_t*);
+int pthread_mutex_destroy(pthread_mutex_t*);
+int pthread_mutex_lock(pthread_mutex_t*);
+int pthread_mutex_trylock(pthread_mutex_t*);
+int pthread_mutex_unlock(pthread_mutex_t*);
+
+int pthread_cond_init(pthread_cond_t*, const pthread_condattr_t*);
+int pthread_cond_destroy(pthread_cond_t*);
+int pthread_cond_wait(pthread_cond_t*, pthread_mutex_t*);
+int pthread_cond_signal(pthread_cond_t*);
+int pthread_cond_broadcast(pthread_cond_t*);
+
+int pthread_barrier_init(pthread_barrier_t*, const pthread_barrierattr_t*, uint);
+int pthread_barrier_destroy(pthread_barrier_t*);
+int pthread_barrier_wait(pthread_barrier_t*);
+
+int pthread_rwlock_init(pthread_rwlock_t*, const pthread_rwlockattr_t*);
+int pthread_rwlock_destroy(pthread_rwlock_t*);
+int pthread_rwlock_rdlock(pthread_rwlock_t*);
+int pthread_rwlock_wrlock(pthread_rwlock_t*);
+int pthread_rwlock_unlock(pthread_rwlock_t*);
@@ -0,0 +1,43 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "param.h"
+#include "schedconf.h"
+
+// Print or set scheduler tunables:
+//   schedconf
+//   schedconf boost stride_cap quantum0 [quantum1 ...]
+// The number of quanta given is the number of MLFQ levels.
+
+int
+main(int argc, char *argv[])
+{
+  struct schedconf sc;
+  int i;
+
+  if(argc > 1){
+    if(argc < 4 || argc - 3 > NMLFQ){
+      printf(2, "usage: schedconf [boost stride_cap quantum0 ... quantum%d]\n", NMLFQ - 1);
+      exit();
+    }
+    sc.boost = atoi(argv[1]);
+    sc.stride_cap = atoi(argv[2]);
+    sc.nlevel = argc - 3;
+    for(i = 0; i < sc.nlevel; i++)
+      sc.quantum[i] = atoi(argv[i + 3]);
+    if(setschedconf(&sc) < 0){
+      printf(2, "schedconf: invalid tunables\n");
+      exit();
+    }
+  }
+
+  if(getschedconf(&sc) < 0){
+    printf(2, "getschedconf failed\n");
+    exit();
+  }
+  printf(1, "boost %d, stride cap %d%%, %d levels, quanta", sc.boost, sc.stride_cap, sc.nlevel);
+  for(i = 0; i < sc.nlevel; i++)
+    printf(1, " %d", sc.quantum[i]);
+  printf(1, "\n");
+  exit();
+}
@@ -0,0 +1,8 @@
+// Scheduler tunables, read by getschedconf() and set by setschedconf().
+
+struct schedconf {
+  int nlevel;                  // MLFQ levels in use (1..NMLFQ)
+  int quantum[NMLFQ];          // Time slice of each MLFQ level, in ticks
+  int boost;                   // Ticks between MLFQ priority boosts
+  int stride_cap;              // Maximum total CPU share of Stride processes (percent)
+};
@@ -0,0 +1,61 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "param.h"
+#include "schedstat.h"
+#include "schedconf.h"
+
+// Print scheduler statistics of every process, thread and CPU.
+// Pass values are divided by 1024 to fit in 32 bits.
+// Ticks are shown for each MLFQ level in use, and for any level
+// above it which a process ran at before the levels were cut.
+
+static char *states[] = {
+  "unused", "embryo", "sleep ", "runble", "run   ", "zombie"
+};
+
+struct schedstat ss;  // too big for the user stack
+
+int
+main(int argc, char *argv[])
+{
+  struct schedconf sc;
+  struct procstat *p;
+  int i, l, nlevel;
+
+  if(getschedstat(&ss) < 0){
+    printf(1, "getschedstat failed\n");
+    exit();
+  }
+  if(getschedconf(&sc) < 0){
+    printf(1, "getschedconf failed\n");
+    exit();
+  }
+
+  nlevel = sc.nlevel;
+  for(i = 0; i < ss.nproc; i++){
+    for(l = nlevel; l < NMLFQ; l++)
+      if(ss.proc[i].rticks[l])
+        nlevel = l + 1;
+  }
+
+  printf(1, "pid\ttid\tstate\tname\tlev\t");
+  for(l = 0; l < nlevel; l++)
+    printf(1, "l%d\t", l);
+  printf(1, "sticks\tshare\tpass\tvcsw\tivcsw\twait_us\tcpu\tmig\n");
+  for(i = 0; i < ss.nproc; i++){
+    p = &ss.proc[i];
+    printf(1, "%d\t%d\t%s\t%s\t%d\t",
+           p->pid, p->tid, states[p->state], p->name, p->priority);
+    for(l = 0; l < nlevel; l++)
+      printf(1, "%d\t", p->rticks[l]);
+    printf(1, "%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\n",
+           p->sticks, p->tickets, (uint)(p->pass_value >> 10),
+           p->nvcsw, p->nivcsw, p->wait_us, p->lastcpu, p->nmigrate);
+  }
+
+  for(i = 0; i < ss.ncpu; i++)
+    printf(1, "cpu%d: busy %d, idle %d, queued %d\n",
+           i, ss.cpu[i].busyticks, ss.cpu[i].idleticks, ss.cpu[i].nrun);
+  exit();
+}
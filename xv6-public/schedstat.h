@@ -0,0 +1,35 @@
+// Scheduler statistics, filled in by getschedstat().
+
+struct procstat {
+  int pid;                     // Process ID
+  int tid;                     // Thread ID (-1 for a process)
+  int state;                   // enum procstate
+  char name[16];               // Process name
+  int priority;                // MLFQ level
+  uint rticks[NMLFQ];          // Ticks run at each MLFQ level
+  uint sticks;                 // Ticks run under stride scheduling
+  int tickets;                 // CPU share (0 if MLFQ)
+  int stride;                  // Stride
+  uint64 pass_value;           // Pass value
+  uint nvcsw;                  // Voluntary context switches
+  uint nivcsw;                 // Involuntary context switches
+  uint wait_us;                // Microseconds spent runnable on a run queue
+  int lastcpu;                 // CPU it last ran on (-1 if never)
+  uint cpumask;                // CPUs it may run on
+  uint nmigrate;               // Migrations between CPUs
+  int edf;                     // Is it an EDF task?
+  uint edf_nmiss;              // EDF jobs which missed their deadline
+};
+
+struct cpustat {
+  uint busyticks;              // Ticks spent running a process
+  uint idleticks;              // Ticks spent without a process to run
+  int nrun;                    // Processes on its run queue
+};
+
+struct schedstat {
+  int nproc;                   // Entries used in proc[]
+  int ncpu;                    // Entries used in cpu[]
+  struct procstat proc[NPROC];
+  struct cpustat cpu[NCPU];
+};
@@ -0,0 +1,89 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "param.h"
+#include "trace.h"
+
+// Print scheduler trace events as a per-CPU timeline.
+// With arguments, run that command and trace only while it runs.
+// Times are microseconds from the first event.
+
+#define NEV 4096
+
+struct traceev evs[NEV];
+
+static char *names[] = {
+  [TR_SWITCHIN]   "in     ",
+  [TR_SWITCHOUT]  "out    ",
+  [TR_WAKEUP]     "wakeup ",
+  [TR_DEMOTE]     "demote ",
+  [TR_BOOST]      "boost  ",
+  [TR_SHARE]      "share  ",
+  [TR_TCREATE]    "tcreate",
+  [TR_TEXIT]      "texit  ",
+};
+
+// Microseconds from a to b, which must be less than 71 minutes apart.
+uint
+usec(struct traceev *a, struct traceev *b)
+{
+  return (b->sec - a->sec) * 1000000 + (int)(b->nsec - a->nsec) / 1000;
+}
+
+int
+main(int argc, char *argv[])
+{
+  struct traceev *first, *in[NCPU];
+  int i, c, n, m, pid, ncpu;
+
+  if(argc > 1){
+    while(tracedrain(evs, NEV) > 0)
+      ;
+    if((pid = fork()) < 0){
+      printf(1, "fork failed\n");
+      exit();
+    }
+    if(pid == 0){
+      exec(argv[1], argv + 1);
+      printf(1, "exec %s failed\n", argv[1]);
+      exit();
+    }
+    wait();
+  }
+
+  n = 0;
+  while(n < NEV && (m = tracedrain(evs + n, NEV - n)) > 0)
+    n += m;
+  if(n == 0){
+    printf(1, "no events\n");
+    exit();
+  }
+
+  first = &evs[0];
+  ncpu = 0;
+  for(i = 0; i < n; i++){
+    if(evs[i].sec < first->sec ||
+       (evs[i].sec == first->sec && evs[i].nsec < first->nsec))
+      first = &evs[i];
+    if(evs[i].cpu >= ncpu)
+      ncpu = evs[i].cpu + 1;
+  }
+
+  for(c = 0; c < ncpu; c++){
+    printf(1, "cpu%d:\n", c);
+    in[c] = 0;
+    for(i = 0; i < n; i++){
+      if(evs[i].cpu != c)
+        continue;
+      printf(1, "%d\t%s pid %d tid %d arg %d", usec(first, &evs[i]),
+             names[evs[i].type], evs[i].pid, evs[i].tid, evs[i].arg);
+      if(evs[i].type == TR_SWITCHIN)
+        in[c] = &evs[i];
+      if(evs[i].type == TR_SWITCHOUT && in[c] && in[c]->pid == evs[i].pid &&
+         in[c]->tid == evs[i].tid)
+        printf(1, " ran %d", usec(in[c], &evs[i]));
+      printf(1, "\n");
+    }
+  }
+  exit();
+}
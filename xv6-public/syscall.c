@@ -106,6 +106,21 @@ extern int sys_set_cpu_share(void);
 extern int sys_thread_create(void);
 extern int sys_thread_exit(void);
 extern int sys_thread_join(void);
+extern int sys_clock_gettime(void);
+extern int sys_nanosleep(void);
+extern int sys_getschedstat(void);
+extern int sys_tracedrain(void);
+extern int sys_sched_setaffinity(void);
+extern int sys_sched_getaffinity(void);
+extern int sys_set_gang(void);
+extern int sys_yield_to(void);
+extern int sys_gettid(void);
+extern int sys_sched_deadline(void);
+extern int sys_getschedconf(void);
+extern int sys_setschedconf(void);
+extern int sys_futex_wait(void);
+extern int sys_futex_wake(void);
+extern int sys_thread_create_stack(void);
 
 static int (*syscalls[])(void) = {
 [SYS_fork]    sys_fork,
@@ -137,6 +152,21 @@ static int (*syscalls[])(void) = {
 [SYS_thread_create]     sys_thread_create,
 [SYS_thread_exit]       sys_thread_exit,
 [SYS_thread_join]       sys_thread_join,
+[SYS_clock_gettime]     sys_clock_gettime,
+[SYS_nanosleep]         sys_nanosleep,
+[SYS_getschedstat]      sys_getschedstat,
+[SYS_tracedrain]        sys_tracedrain,
+[SYS_sched_setaffinity] sys_sched_setaffinity,
+[SYS_sched_getaffinity] sys_sched_getaffinity,
+[SYS_set_gang]          sys_set_gang,
+[SYS_yield_to]          sys_yield_to,
+[SYS_gettid]            sys_gettid,
+[SYS_sched_deadline]    sys_sched_deadline,
+[SYS_getschedconf]      sys_getschedconf,
+[SYS_setschedconf]      sys_setschedconf,
+[SYS_futex_wait]        sys_futex_wait,
+[SYS_futex_wake]        sys_futex_wake,
+[SYS_thread_create_stack] sys_thread_create_stack,
 };
 
 void
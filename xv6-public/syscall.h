@@ -28,3 +28,18 @@
 #define SYS_thread_create 27
 #define SYS_thread_exit 28
 #define SYS_thread_join 29
+#define SYS_clock_gettime 30
+#define SYS_nanosleep 31
+#define SYS_getschedstat 32
+#define SYS_tracedrain 33
+#define SYS_sched_setaffinity 34
+#define SYS_sched_getaffinity 35
+#define SYS_set_gang 36
+#define SYS_yield_to 37
+#define SYS_gettid 38
+#define SYS_sched_deadline 39
+#define SYS_getschedconf 40
+#define SYS_setschedconf 41
+#define SYS_futex_wait 42
+#define SYS_futex_wake 43
+#define SYS_thread_create_stack 44
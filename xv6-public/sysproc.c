@@ -6,6 +6,10 @@
 #include "memlayout.h"
 #include "mmu.h"
 #include "proc.h"
+#include "ktimer.h"
+#include "schedstat.h"
+#include "schedconf.h"
+#include "trace.h"
 
 int
 sys_fork(void)
@@ -63,16 +67,150 @@ sys_set_cpu_share(void)
 int
 sys_yield(void)
 {
-    yield(0);
+    proc->nvcsw++;
+    if(proc->edf)
+        edf_yield();
+    else
+        yield(0);
     return 0;
 }
 
+int
+sys_sched_deadline(void)
+{
+    int runtime, period, deadline;
+
+    if(argint(0, &runtime) < 0 || argint(1, &period) < 0 || argint(2, &deadline) < 0)
+        return -1;
+
+    return sched_deadline(runtime, period, deadline);
+}
+
+int
+sys_yield_to(void)
+{
+    int tid;
+
+    if(argint(0, &tid) < 0)
+        return -1;
+
+    return yield_to(tid);
+}
+
+int
+sys_gettid(void)
+{
+    return proc->tid;
+}
+
+int
+sys_futex_wait(void)
+{
+    int addr, val;
+
+    if(argint(0, &addr) < 0 || argint(1, &val) < 0)
+        return -1;
+
+    return futex_wait(addr, val);
+}
+
+int
+sys_futex_wake(void)
+{
+    int addr, n;
+
+    if(argint(0, &addr) < 0 || argint(1, &n) < 0)
+        return -1;
+
+    return futex_wake(addr, n);
+}
+
 int
 sys_getlev(void)
 {
     return getlev();
 }
 
+int
+sys_getschedstat(void)
+{
+    struct schedstat *ss;
+
+    if(argptr(0, (char**)&ss, sizeof(*ss)) < 0)
+        return -1;
+
+    return getschedstat(ss);
+}
+
+int
+sys_getschedconf(void)
+{
+    struct schedconf *sc;
+
+    if(argptr(0, (char**)&sc, sizeof(*sc)) < 0)
+        return -1;
+
+    return getschedconf(sc);
+}
+
+int
+sys_setschedconf(void)
+{
+    struct schedconf *sc;
+
+    if(argptr(0, (char**)&sc, sizeof(*sc)) < 0)
+        return -1;
+
+    return setschedconf(sc);
+}
+
+int
+sys_sched_setaffinity(void)
+{
+    int pid, mask;
+
+    if(argint(0, &pid) < 0 || argint(1, &mask) < 0)
+        return -1;
+
+    return sched_setaffinity(pid, mask);
+}
+
+int
+sys_sched_getaffinity(void)
+{
+    int pid;
+
+    if(argint(0, &pid) < 0)
+        return -1;
+
+    return sched_getaffinity(pid);
+}
+
+int
+sys_set_gang(void)
+{
+    int on;
+
+    if(argint(0, &on) < 0)
+        return -1;
+
+    return set_gang(on);
+}
+
+int
+sys_tracedrain(void)
+{
+    struct traceev *buf;
+    int n;
+
+    if(argint(1, &n) < 0 || n < 0 || n > proc->sz / sizeof(*buf))
+        return -1;
+    if(argptr(0, (char**)&buf, n * sizeof(*buf)) < 0)
+        return -1;
+
+    return tracedrain(buf, n);
+}
+
 int
 sys_sbrk(void)
 {
@@ -92,27 +230,67 @@ sys_sbrk(void)
   return addr;
 }
 
+// Wake up the process sleeping on timer t.
+static void
+sleep_timeout(void *t)
+{
+  wakeup(t);
+}
+
 int
 sys_sleep(void)
 {
   int n;
   uint ticks0;
+  struct ktimer t;
 
   if(argint(0, &n) < 0)
     return -1;
   acquire(&tickslock);
   ticks0 = ticks;
+  ktimer_init(&t, sleep_timeout, &t);
+  ktimer_arm(&t, ticks0 + n);
   while(ticks - ticks0 < n){
     if(proc->killed){
+      ktimer_cancel(&t);
       release(&tickslock);
       return -1;
     }
-    sleep(&ticks, &tickslock);
+    sleep(&t, &tickslock);
   }
+  ktimer_cancel(&t);
   release(&tickslock);
   return 0;
 }
 
+int
+sys_clock_gettime(void)
+{
+  int clk;
+  struct timespec *ts;
+  uint nsec;
+
+  if(argint(0, &clk) < 0 || argptr(1, (char**)&ts, sizeof(*ts)) < 0)
+    return -1;
+  if(clk != CLOCK_MONOTONIC)
+    return -1;
+  ts->tv_sec = divu64(nanotime(), 1000000000, &nsec);
+  ts->tv_nsec = nsec;
+  return 0;
+}
+
+int
+sys_nanosleep(void)
+{
+  struct timespec *req;
+
+  if(argptr(0, (char**)&req, sizeof(*req)) < 0)
+    return -1;
+  if(req->tv_nsec >= 1000000000)
+    return -1;
+  return nanosleep((uint64)req->tv_sec * 1000000000 + req->tv_nsec);
+}
+
 // return how many clock tick interrupts have occurred
 // since start.
 int
@@ -139,7 +317,18 @@ sys_thread_create(void)
   if(argint(2, &arg) < 0)
     return -1;
 
-  return thread_create((thread_t *)thread,(void *(*)(void *))routine,(void *)arg);
+  return thread_create((thread_t *)thread,(void *(*)(void *))routine,(void *)arg, 0);
+}
+int
+sys_thread_create_stack(void)
+{
+  int thread,routine,arg,stacksize;
+
+  if(argint(0, &thread) < 0 || argint(1, &routine) < 0 ||
+     argint(2, &arg) < 0 || argint(3, &stacksize) < 0)
+    return -1;
+
+  return thread_create((thread_t *)thread,(void *(*)(void *))routine,(void *)arg, stacksize);
 }
 int
 sys_thread_exit(void)
@@ -0,0 +1,58 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "date.h"
+
+// Measure clock_gettime resolution and nanosleep overshoot.
+
+#define NLOOP 20
+
+int
+main(int argc, char *argv[])
+{
+  struct timespec t0, t1, req;
+  uint d, min, total;
+  int i, j;
+  uint want[3] = { 100000, 1000000, 5000000 };  // 100us, 1ms, 5ms
+
+  if(clock_gettime(CLOCK_MONOTONIC, &t0) < 0){
+    printf(1, "clock_gettime failed\n");
+    exit();
+  }
+
+  min = 0xFFFFFFFF;
+  for(i = 0; i < NLOOP; i++){
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    do
+      clock_gettime(CLOCK_MONOTONIC, &t1);
+    while((d = timespec_diff(&t0, &t1, 1)) == 0);
+    if(d < min)
+      min = d;
+  }
+  printf(1, "clock resolution: %d ns\n", min);
+
+  for(j = 0; j < 3; j++){
+    req.tv_sec = 0;
+    req.tv_nsec = want[j];
+    total = 0;
+    for(i = 0; i < NLOOP; i++){
+      clock_gettime(CLOCK_MONOTONIC, &t0);
+      if(nanosleep(&req) < 0){
+        printf(1, "nanosleep failed\n");
+        exit();
+      }
+      clock_gettime(CLOCK_MONOTONIC, &t1);
+      // In us, so that a long overshoot doesn't wrap.
+      d = timespec_diff(&t0, &t1, 1000);
+      if(d < want[j] / 1000){
+        printf(1, "nanosleep %d us woke up early: %d us\n", want[j] / 1000, d);
+        exit();
+      }
+      total += d - want[j] / 1000;
+    }
+    printf(1, "nanosleep %d us: average overshoot %d us\n",
+           want[j] / 1000, total / NLOOP);
+  }
+  printf(1, "test_clock ok\n");
+  exit();
+}
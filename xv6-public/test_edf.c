@@ -0,0 +1,140 @@
+/**
+ *  This program runs EDF real-time children next to MLFQ load.
+ *  Each EDF child runs NJOB jobs, which take about half of its runtime,
+ * and reports how many of them missed their deadline.
+ */
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "param.h"
+#include "schedstat.h"
+
+// Number of EDF children
+#define CNT_EDF             3
+// Number of jobs every EDF child runs
+#define NJOB                50
+
+// Name of child test program that tests MLFQ scheduler
+#define NAME_CHILD_MLFQ     "test_mlfq"
+
+// (runtime, period, deadline) in ticks
+int edf_param[CNT_EDF][3] = {
+  {2, 10, 10},
+  {3, 20, 15},
+  {5, 50, 50},
+};
+
+char *mlfq_argv[] = {NAME_CHILD_MLFQ, "0", 0};
+
+struct schedstat ss;
+
+// Loop iterations which take about one tick
+uint
+calibrate(void)
+{
+  uint n, t0;
+
+  t0 = uptime();
+  while (uptime() == t0)
+    ;
+  t0 = uptime();
+  for (n = 0; uptime() < t0 + 10; n++)
+    __sync_synchronize();
+  return n / 10;
+}
+
+// Deadline misses of the calling process
+int
+nmiss(void)
+{
+  int i, pid;
+
+  pid = getpid();
+  if (getschedstat(&ss) < 0)
+    return -1;
+  for (i = 0; i < ss.nproc; i++)
+    if (ss.proc[i].pid == pid && ss.proc[i].tid == -1)
+      return ss.proc[i].edf_nmiss;
+  return -1;
+}
+
+void
+edf_child(int *param, uint loops, int fd)
+{
+  int j, res[4];
+  uint i;
+
+  if (sched_deadline(param[0], param[1], param[2]) < 0) {
+    printf(1, "EDF(%d/%d/%d) not admitted\n", param[0], param[1], param[2]);
+    exit();
+  }
+
+  for (j = 0; j < NJOB; j++) {
+    for (i = 0; i < loops * param[0] / 2; i++)
+      __sync_synchronize();
+    // Job is done; wait for next release.
+    yield();
+  }
+
+  res[0] = param[0];
+  res[1] = param[1];
+  res[2] = param[2];
+  res[3] = nmiss();
+  write(fd, res, sizeof(res));
+  exit();
+}
+
+int
+main(int argc, char *argv[])
+{
+  int fd[2], res[4];
+  int i, pid, nchild;
+  uint loops;
+
+  // Invalid parameters and over-admission are rejected.
+  if (sched_deadline(0, 10, 10) == 0 || sched_deadline(5, 10, 4) == 0 ||
+      sched_deadline(10, 10, 10) == 0 || sched_deadline(2200000, 0x7fffffff, 0x7fffffff) == 0) {
+    printf(1, "EDF admission control failed\n");
+    exit();
+  }
+
+  if (pipe(fd) < 0) {
+    printf(1, "pipe failed!!\n");
+    exit();
+  }
+  loops = calibrate();
+
+  nchild = 0;
+  for (i = 0; i < 2; i++) {
+    pid = fork();
+    if (pid == 0) {
+      close(fd[0]);
+      exec(mlfq_argv[0], mlfq_argv);
+      printf(1, "exec failed!!\n");
+      exit();
+    }
+    if (pid > 0)
+      nchild++;
+  }
+  for (i = 0; i < CNT_EDF; i++) {
+    pid = fork();
+    if (pid == 0) {
+      close(fd[0]);
+      edf_child(edf_param[i], loops, fd[1]);
+    }
+    if (pid > 0)
+      nchild++;
+  }
+
+  close(fd[1]);
+  while (read(fd[0], res, sizeof(res)) == sizeof(res))
+    printf(1, "EDF(%d/%d/%d), jobs: %d, deadline misses: %d\n",
+           res[0], res[1], res[2], NJOB, res[3]);
+  close(fd[0]);
+
+  while (nchild-- > 0)
+    wait();
+
+  exit();
+}
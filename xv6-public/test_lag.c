@@ -0,0 +1,103 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "param.h"
+#include "schedstat.h"
+
+// Stride processes wait on CPU 0 while a gang scheduled Stride process
+// pushes its virtual time ahead of them. Then they may run anywhere,
+// so other CPUs pull them by load balancing. Each of them must still
+// run afterwards, however far it lagged behind virtual time.
+
+#define NLAG    4
+#define NGANG   2
+#define PHASE   200     // (ticks)
+
+struct schedstat ss;
+
+void
+spin(void)
+{
+  for(;;)
+    ;
+}
+
+void*
+gangworker(void *arg)
+{
+  spin();
+  return 0;
+}
+
+// Returns ticks process pid has run under stride scheduling, or -1.
+int
+sticks(int pid)
+{
+  int i;
+
+  for(i = 0; i < ss.nproc; i++){
+    if(ss.proc[i].pid == pid && ss.proc[i].tid == -1)
+      return ss.proc[i].sticks;
+  }
+  return -1;
+}
+
+int
+main(int argc, char *argv[])
+{
+  int lag[NLAG], before[NLAG];
+  int gang, i, bad;
+  thread_t t;
+
+  getschedstat(&ss);
+  if(ss.ncpu < 2){
+    printf(1, "test_lag needs 2 CPUs or more\n");
+    exit();
+  }
+
+  for(i = 0; i < NLAG; i++){
+    if((lag[i] = fork()) == 0){
+      sched_setaffinity(0, 1);
+      set_cpu_share(5);
+      spin();
+    }
+  }
+
+  if((gang = fork()) == 0){
+    set_cpu_share(40);
+    set_gang(1);
+    for(i = 0; i < NGANG; i++)
+      thread_create(&t, gangworker, 0);
+    spin();
+  }
+
+  // Let the gang run ahead on CPU 0, then let the laggers go.
+  sleep(PHASE);
+  for(i = 0; i < NLAG; i++)
+    sched_setaffinity(lag[i], (1 << ss.ncpu) - 1);
+  sleep(PHASE);
+
+  getschedstat(&ss);
+  for(i = 0; i < NLAG; i++)
+    before[i] = sticks(lag[i]);
+  sleep(PHASE);
+  getschedstat(&ss);
+
+  bad = 0;
+  for(i = 0; i < NLAG; i++){
+    if(sticks(lag[i]) <= before[i]){
+      printf(1, "pid %d didn't run: %d ticks, %d before\n", lag[i], sticks(lag[i]), before[i]);
+      bad = 1;
+    }
+  }
+
+  // A process which never runs again can't exit either, so report first.
+  printf(1, "test_lag %s\n", bad ? "FAILED" : "ok");
+
+  for(i = 0; i < NLAG; i++)
+    kill(lag[i]);
+  kill(gang);
+  for(i = 0; i < NLAG + 1; i++)
+    wait();
+  exit();
+}
@@ -1,5 +1,7 @@
 /**
  *  This program runs child test programs concurrently.
+ *  After all children exit, reports how far each Stride child's measured
+ * share (cnt / sum of Stride cnt) is from its requested share.
  */
 
 #include "types.h"
@@ -14,10 +16,13 @@
 // Name of child test program that tests MLFQ scheduler
 #define NAME_CHILD_MLFQ     "test_mlfq"
 
-char *child_argv[CNT_CHILD][3] = {
+// Stride children get result file descriptor as the last argument
+char result_fd[2];
+
+char *child_argv[CNT_CHILD][4] = {
   // Process scheduled by Stride scheduler, use 10% of CPU resources
-  {NAME_CHILD_STRIDE, "10", 0},
-  {NAME_CHILD_STRIDE, "40", 0},
+  {NAME_CHILD_STRIDE, "10", result_fd, 0},
+  {NAME_CHILD_STRIDE, "40", result_fd, 0},
   // Process scheduled by Stride scheduler, use 40% of CPU resources
   {NAME_CHILD_MLFQ, "0", 0},
   // Process scheduled by MLFQ scheduler, does not yield() itself
@@ -25,11 +30,48 @@ char *child_argv[CNT_CHILD][3] = {
   // Process scheduled by MLFQ scheduler, frequently yield()
 };
 
+// Reads (cpu_share, cnt) pairs written by Stride children,
+// then prints the error between requested and measured share.
+void
+report_share_error(int fd)
+{
+  int share[CNT_CHILD], cnt[CNT_CHILD];
+  int n, i, total_share, total_cnt, want, got;
+
+  n = total_share = total_cnt = 0;
+  while (n < CNT_CHILD &&
+         read(fd, &share[n], sizeof(int)) == sizeof(int) &&
+         read(fd, &cnt[n], sizeof(int)) == sizeof(int)) {
+    total_share += share[n];
+    total_cnt += cnt[n];
+    n++;
+  }
+  if (n == 0 || total_cnt == 0)
+    return;
+
+  for (i = 0; i < n; i++) {
+    // In 0.1% units
+    want = share[i] * 1000 / total_share;
+    got = cnt[i] * 1000 / total_cnt;
+    printf(1, "STRIDE(%d%%), want: %d.%d%%, got: %d.%d%%, error: %d.%d%%\n",
+           share[i], want / 10, want % 10, got / 10, got % 10,
+           (got > want ? got - want : want - got) / 10,
+           (got > want ? got - want : want - got) % 10);
+  }
+}
+
 int
 main(int argc, char *argv[])
 {
   int pid;
   int i;
+  int fd[2];
+
+  if (pipe(fd) < 0) {
+    printf(1, "pipe failed!!\n");
+    exit();
+  }
+  result_fd[0] = '0' + fd[1];
 
   for (i = 0; i < CNT_CHILD; i++) {
     pid = fork();
@@ -38,6 +80,7 @@ main(int argc, char *argv[])
       continue;
     } else if (pid == 0) {
       // child
+      close(fd[0]);
       exec(child_argv[i][0], child_argv[i]);
       printf(1, "exec failed!!\n");
       exit();
@@ -47,9 +90,13 @@ main(int argc, char *argv[])
     }
   }
   
+  close(fd[1]);
   for (i = 0; i < CNT_CHILD; i++) {
     wait();
   }
 
+  report_share_error(fd[0]);
+  close(fd[0]);
+
   exit();
 }
@@ -0,0 +1,118 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+
+// Many idle sleepers with different timeouts.
+// Each sleeper checks that it did not wake up early.
+// Then a loop on CPU 0 is timed with and without NSLEEPER long sleepers
+// on that CPU. The timer wheel looks only at expiring timers, so they
+// don't slow it down; the old per-tick wakeup(&ticks) woke every one of
+// them on every tick.
+
+#define NSLEEPER 50
+#define WORKTICKS 100   // ticks the loop is timed for
+#define MAXLOSS   5     // percent of work the sleepers may take
+
+// Returns how much work the loop does in WORKTICKS ticks.
+uint
+work(void)
+{
+  uint n;
+  int i, start;
+
+  start = uptime();
+  while(uptime() == start)
+    ;
+  start++;
+  for(n = 0; uptime() - start < WORKTICKS; n++){
+    for(i = 0; i < 1000; i++)
+      __sync_synchronize();
+  }
+  return n;
+}
+
+// Returns percent of work done with NSLEEPER long sleepers on CPU 0.
+int
+sleepers_cost(void)
+{
+  uint alone, loaded;
+  int i, pid[NSLEEPER];
+
+  // Sleepers inherit affinity, so they'd run on CPU 0 when woken.
+  sched_setaffinity(0, 1);
+  alone = work();
+  for(i = 0; i < NSLEEPER; i++){
+    if((pid[i] = fork()) < 0){
+      printf(1, "fork panic\n");
+      exit();
+    }
+    if(pid[i] == 0){
+      sleep(10 * WORKTICKS);
+      exit();
+    }
+  }
+  sleep(10);
+  loaded = work();
+  for(i = 0; i < NSLEEPER; i++)
+    kill(pid[i]);
+  for(i = 0; i < NSLEEPER; i++)
+    wait();
+
+  printf(1, "work in %d ticks: %d alone, %d with %d sleepers\n",
+         WORKTICKS, alone, loaded, NSLEEPER);
+  return loaded / (alone / 100 + 1);
+}
+
+int
+main(int argc, char *argv[])
+{
+  int i, n, start, end, fd[2];
+  int early = 0;
+  char c;
+
+  if(pipe(fd) < 0){
+    printf(1, "pipe panic\n");
+    exit();
+  }
+
+  start = uptime();
+  for(i = 0; i < NSLEEPER; i++){
+    if((n = fork()) < 0){
+      printf(1, "fork panic\n");
+      exit();
+    }
+    if(n == 0){
+      close(fd[0]);
+      n = 10 * (i % 10 + 1);
+      start = uptime();
+      sleep(n);
+      c = (uptime() - start < n) ? 'E' : 'O';
+      write(fd[1], &c, 1);
+      exit();
+    }
+  }
+  close(fd[1]);
+
+  for(i = 0; i < NSLEEPER; i++){
+    if(read(fd[0], &c, 1) != 1){
+      printf(1, "read panic\n");
+      exit();
+    }
+    if(c == 'E')
+      early++;
+  }
+  for(i = 0; i < NSLEEPER; i++)
+    wait();
+  end = uptime();
+
+  printf(1, "%d sleepers, %d woke up early, %d ticks\n", NSLEEPER, early, end - start);
+  if(sleepers_cost() < 100 - MAXLOSS){
+    printf(1, "test_sleep failed: sleepers slow down ticks\n");
+    exit();
+  }
+  if(early == 0)
+    printf(1, "test_sleep ok\n");
+  else
+    printf(1, "test_sleep failed\n");
+  exit();
+}
@@ -2,15 +2,38 @@
  *  This program requests portion of CPU resources with given parameter
  * value by calling set_cpu_share() system call.
  *  After that, periodically increases cnt values until its LIFETIME.
+ *  If a file descriptor is given as second parameter, writes its cpu share
+ * and cnt there, so that the parent can measure the share error.
+ *  At the end, reports how many times it migrated between CPUs.
  */
 
 #include "types.h"
 #include "stat.h"
 #include "user.h"
+#include "param.h"
+#include "schedstat.h"
 
 #define LIFETIME        2000        // (ticks)
 #define COUNT_PERIOD    1000000     // (iteration)
 
+struct schedstat ss;
+
+// Returns how many times this process migrated between CPUs.
+int
+migrations(void)
+{
+  int i, pid;
+
+  pid = getpid();
+  if (getschedstat(&ss) < 0)
+    return -1;
+  for (i = 0; i < ss.nproc; i++) {
+    if (ss.proc[i].pid == pid && ss.proc[i].tid == -1)
+      return ss.proc[i].nmigrate;
+  }
+  return -1;
+}
+
 int
 main(int argc, char *argv[])
 {
@@ -21,7 +44,7 @@ main(int argc, char *argv[])
   uint curr_tick;
 
   if (argc < 2) {
-    printf(1, "usage: sched_test_stride cpu_share(%)\n");
+    printf(1, "usage: sched_test_stride cpu_share(%) [result_fd]\n");
     exit();
   }
 
@@ -50,7 +73,11 @@ main(int argc, char *argv[])
 
       if (curr_tick - start_tick > LIFETIME) {
         // Terminate process
-        printf(1, "STRIDE(%d%%), cnt: %d\n", cpu_share, cnt);
+        printf(1, "STRIDE(%d%%), cnt: %d, migrations: %d\n", cpu_share, cnt, migrations());
+        if (argc >= 3) {
+          write(atoi(argv[2]), &cpu_share, sizeof(cpu_share));
+          write(atoi(argv[2]), &cnt, sizeof(cnt));
+        }
         break;
       }
       i = 0;
@@ -0,0 +1,71 @@
+// Thread create/join microbenchmark.
+// A fresh process has no cached thread stacks, so its first
+// create/join pair allocates (and zeroes) a kernel stack and a user
+// stack; later pairs reuse the ones the previous thread left.
+
+#include "types.h"
+#include "user.h"
+#include "date.h"
+
+#define NCOLD   20     // fresh processes, one pair each
+#define NWARM   1000   // pairs in one process, a multiple of 1000
+
+void*
+nopthread(void *arg)
+{
+  thread_exit(arg);
+}
+
+// Create and join n threads one after another, returning the time it took in us.
+uint
+pairs(int n)
+{
+  struct timespec t0, t1;
+  thread_t t;
+  void *ret;
+  int i;
+
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  for(i = 0; i < n; i++){
+    if(thread_create(&t, nopthread, 0) != 0 || thread_join(t, &ret) != 0){
+      printf(1, "thread_create/join failed\n");
+      exit();
+    }
+  }
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  return timespec_diff(&t0, &t1, 1000);
+}
+
+int
+main(int argc, char *argv[])
+{
+  int fd[2], i;
+  uint us, cold, warm;
+
+  if(pipe(fd) < 0){
+    printf(1, "pipe failed\n");
+    exit();
+  }
+
+  cold = 0;
+  for(i = 0; i < NCOLD; i++){
+    if(fork() == 0){
+      us = pairs(1);
+      write(fd[1], &us, sizeof(us));
+      exit();
+    }
+    wait();
+    if(read(fd[0], &us, sizeof(us)) != sizeof(us)){
+      printf(1, "read failed\n");
+      exit();
+    }
+    cold += us;
+  }
+
+  pairs(1);  // fill the cache
+  warm = pairs(NWARM);
+
+  printf(1, "create+join: %d ns without cached stacks, %d ns with\n",
+         cold * (1000 / NCOLD), warm / (NWARM / 1000));
+  exit();
+}
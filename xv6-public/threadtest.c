@@ -1,9 +1,10 @@
 #include "types.h"
 #include "stat.h"
 #include "user.h"
+#include "date.h"
 
 #define NUM_THREAD 10
-#define NTEST 5
+#define NTEST 11
 
 // Show race condition
 int racingtest(void);
@@ -16,6 +17,24 @@ int jointest2(void);
 // Test whether a process can reuse the thread stack
 int stresstest(void);
 
+// Compare switch cost between threads and between processes
+int switchtest(void);
+
+// User spinlock whose waiters yield to the holder
+int yieldtotest(void);
+
+// Mutex which sleeps in the kernel only when contended
+int futextest(void);
+
+// Many threads with large stacks, whose room is reused
+int manythreadtest(void);
+
+// Joiners wait for their own target, and bad tids fail
+int jointidtest(void);
+
+// Process can't shrink past the stack of a live thread
+int sbrkstacktest(void);
+
 int gcnt;
 int gpipe[2];
 
@@ -25,6 +44,12 @@ int (*testfunc[NTEST])(void) = {
   jointest1,
   jointest2,
   stresstest,
+  switchtest,
+  yieldtotest,
+  futextest,
+  manythreadtest,
+  jointidtest,
+  sbrkstacktest,
 };
 char *testname[NTEST] = {
   "racingtest",
@@ -32,6 +57,12 @@ char *testname[NTEST] = {
   "jointest1",
   "jointest2",
   "stresstest",
+  "switchtest",
+  "yieldtotest",
+  "futextest",
+  "manythreadtest",
+  "jointidtest",
+  "sbrkstacktest",
 };
 
 int
@@ -256,3 +287,401 @@ stresstest(void)
 }
 
 // ============================================================================
+
+#define NSWITCH 20000   // multiple of 500, so ns per switch comes from us
+
+void*
+switchthreadmain(void *arg)
+{
+  int i;
+  for (i = 0; i < NSWITCH; i++)
+    yield();
+  thread_exit(0);
+}
+
+int
+switchtest(void)
+{
+  thread_t threads[2];
+  struct timespec t0, t1;
+  void *retval;
+  int i, pid;
+  uint tns, pns;
+
+  // Both yielders share one CPU, so every yield is a switch.
+  if (sched_setaffinity(0, 1) < 0){
+    printf(1, "panic at sched_setaffinity\n");
+    return -1;
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  for (i = 0; i < 2; i++){
+    if (thread_create(&threads[i], switchthreadmain, 0) != 0){
+      printf(1, "panic at thread_create\n");
+      return -1;
+    }
+  }
+  for (i = 0; i < 2; i++){
+    if (thread_join(threads[i], &retval) != 0){
+      printf(1, "panic at thread_join\n");
+      return -1;
+    }
+  }
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  tns = timespec_diff(&t0, &t1, 1000) / (2 * NSWITCH / 1000);
+
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  for (i = 0; i < 2; i++){
+    if ((pid = fork()) < 0){
+      printf(1, "panic at fork\n");
+      return -1;
+    }
+    if (pid == 0){
+      for (i = 0; i < NSWITCH; i++)
+        yield();
+      exit();
+    }
+  }
+  for (i = 0; i < 2; i++)
+    wait();
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  pns = timespec_diff(&t0, &t1, 1000) / (2 * NSWITCH / 1000);
+
+  printf(1, "switch between threads: %d ns, between processes: %d ns\n", tns, pns);
+  return 0;
+}
+
+// ============================================================================
+
+#define NLOCK 2000
+
+struct spinlock {
+  volatile uint locked;
+  volatile int owner;
+} glock;
+
+void
+spin_lock(struct spinlock *lk)
+{
+  int owner;
+
+  while(__sync_lock_test_and_set(&lk->locked, 1)){
+    // Let the holder run, so it can release the lock.
+    if((owner = lk->owner) <= 0 || yield_to(owner) < 0)
+      yield();
+  }
+  lk->owner = gettid();
+}
+
+void
+spin_unlock(struct spinlock *lk)
+{
+  lk->owner = 0;
+  __sync_lock_release(&lk->locked);
+}
+
+void*
+lockthreadmain(void *arg)
+{
+  int i, j, tmp;
+
+  for (i = 0; i < NLOCK; i++){
+    spin_lock(&glock);
+    tmp = gcnt;
+    for (j = 0; j < 1000; j++)
+      nop();
+    gcnt = tmp + 1;
+    spin_unlock(&glock);
+  }
+  thread_exit(0);
+}
+
+int
+yieldtotest(void)
+{
+  thread_t threads[NUM_THREAD];
+  struct timespec t0, t1;
+  void *retval;
+  int i;
+
+  // More threads than CPUs, so holders get preempted.
+  if (sched_setaffinity(0, 1) < 0){
+    printf(1, "panic at sched_setaffinity\n");
+    return -1;
+  }
+
+  gcnt = 0;
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  for (i = 0; i < NUM_THREAD; i++){
+    if (thread_create(&threads[i], lockthreadmain, 0) != 0){
+      printf(1, "panic at thread_create\n");
+      return -1;
+    }
+  }
+  for (i = 0; i < NUM_THREAD; i++){
+    if (thread_join(threads[i], &retval) != 0){
+      printf(1, "panic at thread_join\n");
+      return -1;
+    }
+  }
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+
+  printf(1, "%d (expected %d), %d ms\n", gcnt, NUM_THREAD * NLOCK,
+         timespec_diff(&t0, &t1, 1000000));
+  return gcnt == NUM_THREAD * NLOCK ? 0 : -1;
+}
+
+// ============================================================================
+
+// 0: unlocked, 1: locked, 2: locked and maybe contended
+volatile uint gmutex;
+
+void
+mutex_lock(volatile uint *m)
+{
+  uint c;
+
+  if((c = __sync_val_compare_and_swap(m, 0, 1)) == 0)
+    return;
+  // Uncontended lock never gets here.
+  if(c != 2)
+    c = __sync_lock_test_and_set(m, 2);
+  while(c != 0){
+    futex_wait(m, 2);
+    c = __sync_lock_test_and_set(m, 2);
+  }
+}
+
+void
+mutex_unlock(volatile uint *m)
+{
+  if(__sync_fetch_and_sub(m, 1) != 1){
+    *m = 0;
+    futex_wake(m, 1);
+  }
+}
+
+void*
+futexthreadmain(void *arg)
+{
+  int i, j, tmp;
+
+  for (i = 0; i < NLOCK; i++){
+    mutex_lock(&gmutex);
+    tmp = gcnt;
+    for (j = 0; j < 1000; j++)
+      nop();
+    gcnt = tmp + 1;
+    mutex_unlock(&gmutex);
+  }
+  thread_exit(0);
+}
+
+int
+futextest(void)
+{
+  thread_t threads[NUM_THREAD];
+  struct timespec t0, t1;
+  void *retval;
+  int i;
+
+  // Word which doesn't hold the expected value doesn't sleep.
+  gmutex = 1;
+  if (futex_wait(&gmutex, 0) != -1 || futex_wake(&gmutex, 1) != 0){
+    printf(1, "panic at futex_wait\n");
+    return -1;
+  }
+
+  gmutex = 0;
+  gcnt = 0;
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  for (i = 0; i < NUM_THREAD; i++){
+    if (thread_create(&threads[i], futexthreadmain, 0) != 0){
+      printf(1, "panic at thread_create\n");
+      return -1;
+    }
+  }
+  for (i = 0; i < NUM_THREAD; i++){
+    if (thread_join(threads[i], &retval) != 0){
+      printf(1, "panic at thread_join\n");
+      return -1;
+    }
+  }
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+
+  printf(1, "%d (expected %d), %d ms\n", gcnt, NUM_THREAD * NLOCK,
+         timespec_diff(&t0, &t1, 1000000));
+  return gcnt == NUM_THREAD * NLOCK ? 0 : -1;
+}
+
+// ============================================================================
+
+#define NMANY       100
+#define MANYSTACK   (4 * 4096)
+
+void*
+manythreadmain(void *arg)
+{
+  char buf[3 * 4096];
+  int i, sum;
+
+  // Touch every page of the stack.
+  for (i = 0; i < sizeof(buf); i++)
+    buf[i] = (int)arg + i;
+  for (sum = 0, i = 0; i < sizeof(buf); i += 4096)
+    sum += buf[i];
+  __sync_fetch_and_add(&gcnt, 1);
+  thread_exit((void*)sum);
+}
+
+int
+manythreadtest(void)
+{
+  thread_t threads[NMANY];
+  void *retval;
+  char *top;
+  int round, i;
+
+  top = 0;
+  for (round = 0; round < 2; round++){
+    gcnt = 0;
+    for (i = 0; i < NMANY; i++){
+      if (thread_create_stack(&threads[i], manythreadmain, (void*)i, MANYSTACK) != 0){
+        printf(1, "panic at thread_create %d\n", i);
+        return -1;
+      }
+    }
+    for (i = 0; i < NMANY; i++){
+      if (thread_join(threads[i], &retval) != 0 || (int)retval != (char)i + (char)(i + 4096) + (char)(i + 8192)){
+        printf(1, "panic at thread_join %d\n", i);
+        return -1;
+      }
+    }
+    if (gcnt != NMANY){
+      printf(1, "panic at gcnt %d\n", gcnt);
+      return -1;
+    }
+    // Stacks of the first round are reused (or given back and taken again).
+    if (round == 0)
+      top = sbrk(0);
+    else if (sbrk(0) != top){
+      printf(1, "panic at sbrk: %x, expected %x\n", sbrk(0), top);
+      return -1;
+    }
+  }
+  printf(1, "%d threads with %d byte stacks, twice\n", NMANY, MANYSTACK);
+  return 0;
+}
+
+// ============================================================================
+
+void*
+sleepthreadmain(void *arg)
+{
+  // Later threads exit first.
+  sleep(10 * (NUM_THREAD - (int)arg));
+  thread_exit((void*)((int)arg + 1));
+}
+
+// Joining itself fails instead of sleeping forever.
+void*
+selfjointhreadmain(void *arg)
+{
+  void *retval;
+
+  thread_exit((void*)thread_join(gettid(), &retval));
+}
+
+int
+jointidtest(void)
+{
+  thread_t threads[NUM_THREAD], self;
+  void *retval;
+  int i;
+
+  for (i = 0; i < NUM_THREAD; i++){
+    if (thread_create(&threads[i], sleepthreadmain, (void*)i) != 0){
+      printf(1, "panic at thread_create\n");
+      return -1;
+    }
+  }
+  for (i = 0; i < NUM_THREAD; i++){
+    if (thread_join(threads[i], &retval) != 0 || (int)retval != i + 1){
+      printf(1, "panic at thread_join\n");
+      return -1;
+    }
+  }
+
+  // Joined thread and unknown tid can't be joined.
+  if (thread_join(threads[0], &retval) != -1 || thread_join(0x7fffffff, &retval) != -1){
+    printf(1, "panic at bad thread_join\n");
+    return -1;
+  }
+
+  // Nor can a thread join itself.
+  if (thread_create(&self, selfjointhreadmain, 0) != 0 || thread_join(self, &retval) != 0){
+    printf(1, "panic at thread_create/join\n");
+    return -1;
+  }
+  if ((int)retval != -1){
+    printf(1, "panic at self thread_join: %d\n", (int)retval);
+    return -1;
+  }
+  return 0;
+}
+
+// ============================================================================
+
+volatile char *gstackaddr;
+volatile int gshrunk;
+
+void*
+sbrkstackthreadmain(void *arg)
+{
+  volatile char buf[64];
+  int i;
+
+  gstackaddr = buf;
+  while (!gshrunk)
+    yield();
+  // Stack is still mapped.
+  for (i = 0; i < sizeof(buf); i++)
+    buf[i] = i;
+  thread_exit((void*)(int)buf[sizeof(buf) - 1]);
+}
+
+int
+sbrkstacktest(void)
+{
+  thread_t t;
+  void *retval;
+  int n;
+
+  gstackaddr = 0;
+  gshrunk = 0;
+  if (thread_create(&t, sbrkstackthreadmain, 0) != 0){
+    printf(1, "panic at thread_create\n");
+    return -1;
+  }
+  while (gstackaddr == 0)
+    yield();
+
+  // Shrinking down to the page of the thread's stack must fail.
+  n = (uint)sbrk(0) - ((uint)gstackaddr & ~4095);
+  if (sbrk(-n) != (char*)-1){
+    printf(1, "panic at sbrk: shrank past a thread stack\n");
+    return -1;
+  }
+  gshrunk = 1;
+  if (thread_join(t, &retval) != 0 || (int)retval != 63){
+    printf(1, "panic at thread_join\n");
+    return -1;
+  }
+
+  // Once it's joined, its cached stack may go.
+  if (sbrk(-n) == (char*)-1){
+    printf(1, "panic at sbrk after thread_join\n");
+    return -1;
+  }
+  return 0;
+}
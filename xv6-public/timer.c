@@ -21,6 +21,30 @@
 #define TIMER_RATEGEN   0x04    // mode 2, rate generator
 #define TIMER_16BIT     0x30    // r/w counter 16 bits, LSB first
 
+#define IO_TIMER2       (IO_TIMER1 + 2) // timer 2 data port
+#define TIMER_SEL2      0x80    // select counter 2
+#define TIMER_INTTC     0x00    // mode 0, interrupt on terminal count
+#define IO_PORTB        0x61    // timer 2 gate and output
+#define PORTB_GATE2     0x01
+#define PORTB_SPKR      0x02
+#define PORTB_OUT2      0x20
+
+// Busy-wait ms milliseconds (at most 50) on counter 2,
+// which is free for use since it only drives the speaker.
+void
+pitdelay(int ms)
+{
+  uint n;
+
+  n = TIMER_FREQ / 1000 * ms;
+  outb(IO_PORTB, (inb(IO_PORTB) & ~PORTB_SPKR) | PORTB_GATE2);
+  outb(TIMER_MODE, TIMER_SEL2 | TIMER_INTTC | TIMER_16BIT);
+  outb(IO_TIMER2, n % 256);
+  outb(IO_TIMER2, n / 256);
+  while((inb(IO_PORTB) & PORTB_OUT2) == 0)
+    ;
+}
+
 void
 timerinit(void)
 {
@@ -0,0 +1,95 @@
+// Scheduler event tracing.
+//
+// Each CPU records events into its own ring buffer without locks:
+// only that CPU writes at head (with interrupts off), and readers
+// advance tail under tracelock. Events are dropped when the ring
+// is full, until a reader drains it.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "memlayout.h"
+#include "mmu.h"
+#include "proc.h"
+#include "x86.h"
+#include "spinlock.h"
+#include "trace.h"
+
+#define NTRACE 512  // events per CPU, a power of 2
+
+struct tracebuf {
+  struct {
+    uint64 tsc;
+    struct traceev ev;
+  } ring[NTRACE];
+  volatile uint head;          // Next slot to write (owning CPU only)
+  volatile uint tail;          // Next slot to read (under tracelock)
+  uint lost;                   // Events dropped because ring was full
+} tracebufs[NCPU];
+
+struct spinlock tracelock;
+
+void
+traceinit(void)
+{
+  initlock(&tracelock, "trace");
+}
+
+// Record an event about p (may be 0) on this CPU.
+void
+trace(int type, struct proc *p, int arg)
+{
+  struct tracebuf *tb;
+  struct traceev *ev;
+  uint h;
+
+  pushcli();
+  tb = &tracebufs[cpu - cpus];
+  h = tb->head;
+  if(h - tb->tail >= NTRACE){
+    tb->lost++;
+    popcli();
+    return;
+  }
+  tb->ring[h % NTRACE].tsc = rdtsc();
+  ev = &tb->ring[h % NTRACE].ev;
+  ev->type = type;
+  ev->cpu = cpu - cpus;
+  ev->pid = p ? p->pid : 0;
+  ev->tid = p ? p->tid : -1;
+  ev->arg = arg;
+  __sync_synchronize();  // publish the event before head
+  tb->head = h + 1;
+  popcli();
+}
+
+// Move up to n events, oldest first on each CPU, to buf.
+// Returns the number of events copied.
+int
+tracedrain(struct traceev *buf, int n)
+{
+  struct tracebuf *tb;
+  struct traceev *ev;
+  uint64 ns;
+  uint h, nsec;
+  int i, cnt;
+
+  cnt = 0;
+  acquire(&tracelock);
+  for(i = 0; i < ncpu; i++){
+    tb = &tracebufs[i];
+    h = tb->head;
+    __sync_synchronize();  // read events only after head
+    while(tb->tail != h && cnt < n){
+      ev = &buf[cnt++];
+      *ev = tb->ring[tb->tail % NTRACE].ev;
+      ns = tsc2ns(tb->ring[tb->tail % NTRACE].tsc);
+      ev->sec = divu64(ns, 1000000000, &nsec);
+      ev->nsec = nsec;
+      __sync_synchronize();  // done reading before the slot is reused
+      tb->tail++;
+    }
+  }
+  release(&tracelock);
+  return cnt;
+}
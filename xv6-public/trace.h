@@ -0,0 +1,20 @@
+// Scheduler trace events, drained by tracedrain().
+
+#define TR_SWITCHIN   1  // Process starts running; arg is its MLFQ level or share
+#define TR_SWITCHOUT  2  // Process stops running; arg is its new state
+#define TR_WAKEUP     3  // Sleeping process becomes runnable; arg is its CPU
+#define TR_DEMOTE     4  // Process moves down an MLFQ level; arg is the new level
+#define TR_BOOST      5  // Priority boost; arg is the boost epoch
+#define TR_SHARE      6  // Process gets a CPU share; arg is the share
+#define TR_TCREATE    7  // Thread is created; arg is its process' pid
+#define TR_TEXIT      8  // Thread exits; arg is its process' pid
+
+struct traceev {
+  uint sec;                    // Time since boot
+  uint nsec;
+  int type;                    // TR_*
+  int cpu;                     // CPU which recorded it
+  int pid;                     // Process ID (0 if none)
+  int tid;                     // Thread ID (-1 for a process)
+  int arg;                     // Depends on type
+};
@@ -37,6 +37,8 @@ idtinit(void)
 void
 trap(struct trapframe *tf)
 {
+  int tick = 0, resched = 0;
+
   if(tf->trapno == T_SYSCALL){
     if(proc->killed)
       exit();
@@ -53,13 +55,33 @@ trap(struct trapframe *tf)
 
   switch(tf->trapno){
   case T_IRQ0 + IRQ_TIMER:
+    // The timer also fires for high-resolution sleepers.
+    if(!(tick = clockintr())){
+      lapiceoi();
+      break;
+    }
     if(cpunum() == 0){
       acquire(&tickslock);
       ticks++;
       add_clock();
-      wakeup(&ticks);
+      ktimer_tick(ticks);
       release(&tickslock);
     }
+    if(proc)
+      cpu->busyticks++;
+    else
+      cpu->idleticks++;
+    edf_tick();
+    load_balance();
+    lapiceoi();
+    break;
+  case T_IRQ0 + IRQ_RESCHED:
+    // Idle CPU woke up from hlt; scheduler() will find the new work.
+    // Or a gang member is waiting for this CPU (see gang_launch).
+    if(cpu->resched){
+      cpu->resched = 0;
+      resched = 1;
+    }
     lapiceoi();
     break;
   case T_IRQ0 + IRQ_IDE:
@@ -108,8 +130,12 @@ trap(struct trapframe *tf)
 
   // Force process to give up CPU on clock tick.
   // If interrupts were on while locks held, would need to check nlock.
-  if(proc && proc->state == RUNNING && tf->trapno == T_IRQ0+IRQ_TIMER)
+  if(proc && proc->state == RUNNING && tick)
     yield(1);
+  else if(proc && proc->state == RUNNING && resched){
+    proc->nivcsw++;
+    yield(0);
+  }
 
   // Check if the process has been killed since we yielded
   if(proc && proc->killed && (tf->cs&3) == DPL_USER)
@@ -35,5 +35,6 @@
 #define IRQ_COM1         4
 #define IRQ_IDE         14
 #define IRQ_ERROR       19
+#define IRQ_RESCHED     20      // Reschedule IPI to an idle CPU
 #define IRQ_SPURIOUS    31
 
@@ -2,6 +2,7 @@
 #include "stat.h"
 #include "fcntl.h"
 #include "user.h"
+#include "date.h"
 #include "x86.h"
 
 char*
@@ -103,3 +104,24 @@ memmove(void *vdst, void *vsrc, int n)
     *dst++ = *src++;
   return vdst;
 }
+
+// Time from a to b in units of unit nanoseconds (1, 1000 or 1000000).
+// 32 bits hold about 4 seconds of ns, 71 minutes of us; longer times
+// give 0xffffffff rather than wrapping, so time long runs in us or ms.
+uint
+timespec_diff(struct timespec *a, struct timespec *b, uint unit)
+{
+  uint sec, per;
+  int nsec;
+
+  sec = b->tv_sec - a->tv_sec;
+  nsec = (int)b->tv_nsec - (int)a->tv_nsec;
+  if(nsec < 0){
+    sec--;
+    nsec += 1000000000;
+  }
+  per = 1000000000 / unit;
+  if(sec > (0xffffffff - nsec / unit) / per)
+    return 0xffffffff;
+  return sec * per + nsec / unit;
+}
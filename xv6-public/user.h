@@ -1,5 +1,9 @@
 struct stat;
 struct rtcdate;
+struct timespec;
+struct schedstat;
+struct schedconf;
+struct traceev;
 
 // system calls
 int fork(void);
@@ -29,8 +33,23 @@ int yield(void);
 int getlev(void);
 int set_cpu_share(int share);
 int thread_create(thread_t *thread, void *(*start_routine)(void *), void *arg);
+int thread_create_stack(thread_t *thread, void *(*start_routine)(void *), void *arg, int stacksize);
 void thread_exit(void *retval) __attribute__((noreturn));
 int thread_join(thread_t thread, void **retval);
+int clock_gettime(int clk, struct timespec *ts);
+int nanosleep(struct timespec *req);
+int getschedstat(struct schedstat *ss);
+int getschedconf(struct schedconf *sc);
+int setschedconf(struct schedconf *sc);
+int futex_wait(volatile uint *addr, uint val);
+int futex_wake(volatile uint *addr, int n);
+int tracedrain(struct traceev *buf, int n);
+int sched_setaffinity(int pid, uint mask);
+int sched_getaffinity(int pid);
+int set_gang(int on);
+int yield_to(int tid);
+int gettid(void);
+int sched_deadline(int runtime, int period, int deadline);
 
 // ulib.c
 int stat(char*, struct stat*);
@@ -45,3 +64,4 @@ void* memset(void*, int, uint);
 void* malloc(uint);
 void free(void*);
 int atoi(const char*);
+uint timespec_diff(struct timespec*, struct timespec*, uint unit);
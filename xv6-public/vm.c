@@ -163,13 +163,25 @@ switchkvm(void)
 void
 switchuvm(struct proc *p)
 {
-  if(p == 0)
-    panic("switchuvm: no process");
-  if(p->kstack == 0)
-    panic("switchuvm: no kstack");
   if(p->pgdir == 0)
     panic("switchuvm: no pgdir");
 
+  pushcli();
+  switchtss(p);
+  lcr3(V2P(p->pgdir));  // switch to process's address space
+  popcli();
+}
+
+// Switch TSS to process p, keeping the h/w page table.
+// For a thread sharing the address space which is loaded.
+void
+switchtss(struct proc *p)
+{
+  if(p == 0)
+    panic("switchtss: no process");
+  if(p->kstack == 0)
+    panic("switchtss: no kstack");
+
   pushcli();
   cpu->gdt[SEG_TSS] = SEG16(STS_T32A, &cpu->ts, sizeof(cpu->ts)-1, 0);
   cpu->gdt[SEG_TSS].s = 0;
@@ -179,7 +191,6 @@ switchuvm(struct proc *p)
   // forbids I/O instructions (e.g., inb and outb) from user space
   cpu->ts.iomb = (ushort) 0xFFFF;
   ltr(SEG_TSS << 3);
-  lcr3(V2P(p->pgdir));  // switch to process's address space
   popcli();
 }
 
@@ -303,6 +314,18 @@ freevm(pde_t *pgdir)
   kfree((char*)pgdir);
 }
 
+// Return 1 if page table pgdir maps a page at va.
+// Unmapped pages above the program image are free room
+// for thread stacks (see tstack_alloc in proc.c).
+int
+uvmmapped(pde_t *pgdir, uint va)
+{
+  pte_t *pte;
+
+  pte = walkpgdir(pgdir, (char*)va, 0);
+  return pte != 0 && (*pte & PTE_P) != 0;
+}
+
 // Clear PTE_U on a page. Used to create an inaccessible
 // page beneath the user stack.
 void
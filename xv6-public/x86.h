@@ -117,6 +117,39 @@ sti(void)
   asm volatile("sti");
 }
 
+// Enable interrupts and halt until one arrives.
+// sti takes effect after the next instruction,
+// so an interrupt can't slip in between the two.
+static inline void
+stihlt(void)
+{
+  asm volatile("sti; hlt");
+}
+
+static inline uint64
+rdtsc(void)
+{
+  uint64 val;
+  asm volatile("rdtsc" : "=A" (val));
+  return val;
+}
+
+// Divide n by d with divl, since there is no libgcc for 64-bit
+// division. If rem isn't 0, the remainder is stored there.
+static inline uint64
+divu64(uint64 n, uint d, uint *rem)
+{
+  uint hi, qhi, qlo, r;
+
+  hi = n >> 32;
+  qhi = hi / d;
+  hi %= d;
+  asm("divl %4" : "=a" (qlo), "=d" (r) : "a" ((uint)n), "d" (hi), "rm" (d));
+  if(rem)
+    *rem = r;
+  return ((uint64)qhi << 32) | qlo;
+}
+
 static inline uint
 xchg(volatile uint *addr, uint newval)
 {